@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include "st7735s.h"
 #include "fonts.h"
 #include "gfx.h"
@@ -7,22 +8,202 @@
 #define abs(x) ( ((x)<0) ? -(x) : (x) )
 #endif
 
+#ifndef MIN
+#define MIN(a,b) ( ((a)<(b)) ? (a) : (b) )
+#endif
+#ifndef MAX
+#define MAX(a,b) ( ((a)>(b)) ? (a) : (b) )
+#endif
+
 /* transparent background for fonts */
 bool bg_transparent = false;
 
+/* last font passed to setFont */
+static uint8_t *font_data = NULL;
+
+#if defined (BANDBUFFER)
+/******************************************************************************
+  Display list // everything drawn until flushBuffer() is replayed once per band
+ ******************************************************************************/
+
+#define DL_CMDS        64
+/* drawText strings are copied, the caller's buffer may be gone by the flush */
+#define DL_TEXT_BYTES  256
+
+typedef enum {
+    DL_PIXEL, DL_BGPIXEL, DL_LINE, DL_RECT, DL_FILLED_RECT,
+    DL_CIRCLE, DL_FILLED_CIRCLE, DL_ARC, DL_PIE, DL_TEXT,
+    /* state changes, replayed in every band */
+    DL_COLOR, DL_BGCOLOR, DL_FONT, DL_TRANSPARENT,
+} dl_op_t;
+
+typedef struct {
+    uint8_t op;
+    int32_t ymin, ymax;     /* rows the command can draw to */
+    union {
+        struct { uint16_t x0, y0, x1, y1; } pt;
+        struct { uint16_t xc, yc, r; float from, to; } arc;
+        struct { uint16_t x, y, str; } text;
+        color565_t c;
+        uint8_t *font;
+        bool transparent;
+    };
+} dl_cmd_t;
+
+static dl_cmd_t dl[DL_CMDS];
+static uint8_t dl_count = 0;
+static char dl_text[DL_TEXT_BYTES];
+static uint16_t dl_text_used = 0;
+/* rows touched by the list */
+static int32_t dl_ymin, dl_ymax;
+
+/* drawing state when the list was started, restored before every band */
+static color565_t dl_color, dl_bg_color;
+static uint8_t *dl_font;
+static bool dl_transparent;
+
+/* set while flushBuffer() draws the list into a band */
+static bool dl_replay = false;
+static int32_t band_top, band_bottom;
+
+static dl_cmd_t *dlAdd(uint8_t op, int32_t ymin, int32_t ymax) {
+
+    if (dl_count == DL_CMDS)
+        flushBuffer();
+
+    if (dl_count == 0) {
+        dl_color = color;
+        dl_bg_color = bg_color;
+        dl_font = font_data;
+        dl_transparent = bg_transparent;
+        dl_ymin = INT32_MAX;
+        dl_ymax = INT32_MIN;
+    }
+
+    if (op < DL_COLOR) {
+        dl_ymin = MIN(dl_ymin, ymin);
+        dl_ymax = MAX(dl_ymax, ymax);
+    }
+
+    dl_cmd_t *c = &dl[dl_count++];
+    c->op = op;
+    c->ymin = ymin;
+    c->ymax = ymax;
+    return c;
+}
+
+/* false while replaying, the caller then draws */
+static bool dlPoints(uint8_t op, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+
+    if (dl_replay)
+        return false;
+
+    dl_cmd_t *c = dlAdd(op, MIN(y0, y1), MAX(y0, y1));
+    c->pt.x0 = x0; c->pt.y0 = y0;
+    c->pt.x1 = x1; c->pt.y1 = y1;
+    return true;
+}
+
+static bool dlArc(uint8_t op, uint16_t xc, uint16_t yc, uint16_t r, float from, float to) {
+
+    if (dl_replay)
+        return false;
+
+    dl_cmd_t *c = dlAdd(op, (int32_t)yc - r, (int32_t)yc + r);
+    c->arc.xc = xc; c->arc.yc = yc; c->arc.r = r;
+    c->arc.from = from; c->arc.to = to;
+    return true;
+}
+
+/* state setters apply right away and only need recording behind a draw */
+static dl_cmd_t *dlState(uint8_t op) {
+
+    if (dl_replay || dl_count == 0)
+        return NULL;
+    return dlAdd(op, 0, 0);
+}
+
+static void dlReplay(void) {
+
+    color = dl_color;
+    bg_color = dl_bg_color;
+    bg_transparent = dl_transparent;
+    if (dl_font != NULL)
+        setFont(dl_font);
+
+    for (uint8_t i = 0; i < dl_count; i++) {
+        const dl_cmd_t *c = &dl[i];
+
+        if (c->op < DL_COLOR && (c->ymax < band_top || c->ymin > band_bottom))
+            continue;
+
+        switch (c->op) {
+            case DL_PIXEL:         setPixel(c->pt.x0, c->pt.y0); break;
+            case DL_BGPIXEL:       setbgPixel(c->pt.x0, c->pt.y0); break;
+            case DL_LINE:          drawLine(c->pt.x0, c->pt.y0, c->pt.x1, c->pt.y1); break;
+            case DL_RECT:          drawRect(c->pt.x0, c->pt.y0, c->pt.x1, c->pt.y1); break;
+            case DL_FILLED_RECT:   filledRect(c->pt.x0, c->pt.y0, c->pt.x1, c->pt.y1); break;
+            case DL_CIRCLE:        drawCircle(c->arc.xc, c->arc.yc, c->arc.r); break;
+            case DL_FILLED_CIRCLE: filledCircle(c->arc.xc, c->arc.yc, c->arc.r); break;
+            case DL_ARC:           drawArc(c->arc.xc, c->arc.yc, c->arc.r, c->arc.from, c->arc.to); break;
+            case DL_PIE:           drawPie(c->arc.xc, c->arc.yc, c->arc.r, c->arc.from, c->arc.to); break;
+            case DL_TEXT:          drawText(c->text.x, c->text.y, &dl_text[c->text.str]); break;
+            case DL_COLOR:         color = c->c; break;
+            case DL_BGCOLOR:       bg_color = c->c; break;
+            case DL_FONT:          setFont(c->font); break;
+            case DL_TRANSPARENT:   bg_transparent = c->transparent; break;
+        }
+    }
+}
+#endif
+
 void setTransparent(bool t) {
     bg_transparent = t;
+#if defined (BANDBUFFER)
+    dl_cmd_t *c = dlState(DL_TRANSPARENT);
+    if (c != NULL)
+        c->transparent = t;
+#endif
 }
 
 void setPixel(uint16_t x, uint16_t y) {
+#if defined (BANDBUFFER)
+    if (dlPoints(DL_PIXEL, x, y, x, y))
+        return;
+#endif
     ST7735S_Pixel(x, y);
 }
 void setbgPixel(uint16_t x, uint16_t y) {
+#if defined (BANDBUFFER)
+    if (dlPoints(DL_BGPIXEL, x, y, x, y))
+        return;
+#endif
     ST7735S_bgPixel(x, y);
 }
 
 void flushBuffer(void) {
+#if defined (BANDBUFFER)
+    if (dl_count == 0)
+        return;
+
+    /* only the bands something was drawn to */
+    int32_t top = MAX(dl_ymin, 0) / BAND_ROWS * BAND_ROWS;
+    int32_t bottom = MIN(dl_ymax, HEIGHT - 1);
+
+    dl_replay = true;
+    for (band_top = top; band_top <= bottom; band_top += BAND_ROWS) {
+        band_bottom = band_top + BAND_ROWS - 1;
+        ST7735S_bandStart(band_top);
+        dlReplay();
+        ST7735S_flush();
+    }
+    dl_replay = false;
+
+    dl_count = 0;
+    dl_text_used = 0;
+#else
     ST7735S_flush();
+#endif
 }
 
 /******************************************************************************
@@ -79,6 +260,25 @@ void _LineHigh(uint16_t x0,uint16_t y0, uint16_t x1, uint16_t y1) {
 
 void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
 
+#if defined (BANDBUFFER)
+    if (dlPoints(DL_LINE, x0, y0, x1, y1))
+        return;
+
+    /* filled shapes are made of lines, most of them miss the band */
+    if (MAX(y0, y1) < band_top || MIN(y0, y1) > band_bottom)
+        return;
+
+    /* vertical lines stop short of the higher end, keep that when clipping */
+    if (x0 == x1 && y0 != y1) {
+        uint16_t top = MAX(MIN(y0, y1), band_top);
+        uint16_t end = MIN(MAX(y0, y1), band_bottom + 1);
+        if (top >= end)
+            return;
+        y0 = top;
+        y1 = end;
+    }
+#endif
+
     uint16_t abs_y = abs(y1 - y0);
     uint16_t abs_x = abs(x1 - x0);
 
@@ -115,6 +315,11 @@ void plot8CirclePoints(uint16_t xc, uint16_t yc, uint16_t x, uint16_t y) {
 
 void drawCircle(uint16_t xc, uint16_t yc, uint16_t r) {
 
+#if defined (BANDBUFFER)
+    if (dlArc(DL_CIRCLE, xc, yc, r, 0, 0))
+        return;
+#endif
+
     int16_t x, y, err;
 
     x = r; y = err = 0;
@@ -130,6 +335,11 @@ void drawCircle(uint16_t xc, uint16_t yc, uint16_t r) {
 
 void filledCircle(uint16_t xc, uint16_t yc, uint16_t r) {
 
+#if defined (BANDBUFFER)
+    if (dlArc(DL_FILLED_CIRCLE, xc, yc, r, 0, 0))
+        return;
+#endif
+
     int16_t x, y, err;
 
     x = r; y = err = 0;
@@ -218,6 +428,11 @@ void plot8ArcPoints(uint16_t xc, uint16_t yc, uint16_t x, uint16_t y) {
 
 void drawArc(uint16_t xc, uint16_t yc, uint16_t r, float a_from, float a_to) {
 
+#if defined (BANDBUFFER)
+    if (!isPie && dlArc(DL_ARC, xc, yc, r, a_from, a_to))
+        return;
+#endif
+
     int16_t x, y, err;
 
     x = r; y = err = 0;
@@ -236,6 +451,11 @@ void drawArc(uint16_t xc, uint16_t yc, uint16_t r, float a_from, float a_to) {
 
 void drawPie(uint16_t xc, uint16_t yc, uint16_t r, float a_from, float a_to) {
 
+#if defined (BANDBUFFER)
+    if (dlArc(DL_PIE, xc, yc, r, a_from, a_to))
+        return;
+#endif
+
     isPie = true;
     drawArc(xc, yc, r, a_from, a_to);
     isPie = false;
@@ -246,6 +466,10 @@ void drawPie(uint16_t xc, uint16_t yc, uint16_t r, float a_from, float a_to) {
  *******************************************************************************/
 
 void drawRect(uint16_t x, uint16_t y, uint16_t x2, uint16_t y2) {
+#if defined (BANDBUFFER)
+    if (dlPoints(DL_RECT, x, y, x2, y2))
+        return;
+#endif
     drawLine(x,  y, x2,  y);
     drawLine(x, y2, x2, y2);
     drawLine(x,  y,  x, y2);
@@ -254,6 +478,11 @@ void drawRect(uint16_t x, uint16_t y, uint16_t x2, uint16_t y2) {
 
 void filledRect(uint16_t x, uint16_t y, uint16_t x2, uint16_t y2) {
 
+#if defined (BANDBUFFER)
+    if (dlPoints(DL_FILLED_RECT, x, y, x2, y2))
+        return;
+#endif
+
     if (x > x2) { uint16_t tmp = x; x = x2; x2 = tmp; }
     if (y > y2) { uint16_t tmp = y; y = y2; y2 = tmp; }
 
@@ -313,56 +542,136 @@ typedef struct {
 
 font_t pfont;
 
+/* glyph number of every 8 bit character, GLYPH_NONE where the font has none */
+#define GLYPH_NONE  0xFFFF
+static uint16_t glyph_index[256];
+/* bitmap bytes of one glyph and of one of its rows */
+static uint16_t glyph_bytes;
+static uint8_t glyph_row_bytes;
+
+void _indexGlyphs(void) {
+
+    uint16_t glnr = 0;
+
+    glyph_row_bytes = (pfont.gi->bbox.width + 7) / 8;
+    glyph_bytes = glyph_row_bytes * pfont.gi->pixel_size;
+
+    memset(glyph_index, 0xFF, sizeof(glyph_index));
+    for(uint16_t i = 0; (uint8_t)pfont.gi->range[i].first != 0 || i == 0; i++) {
+        for (uint16_t c = pfont.gi->range[i].first; c <= pfont.gi->range[i].last; c++, glnr++) {
+            if (c < 256)
+                glyph_index[c] = glnr;
+        }
+    }
+}
+
 void setFont(uint8_t *f) {
     uint8_t i;
 
+#if defined (BANDBUFFER)
+    dl_cmd_t *c = dlState(DL_FONT);
+    if (c != NULL)
+        c->font = f;
+#endif
+
+    /* printToScreen() sets the font for every line, the index only changes with it */
+    if (f == font_data)
+        return;
+    font_data = f;
+
     pfont.gi = (glyph_info_t *)f;
     for(i = 0; (uint8_t)pfont.gi->range[i].first != 0 || i == 0; i++);
     pfont.glyphs = (uint8_t *)f + sizeof(glyph_info_t) +
         i*sizeof(ch_range_t) + sizeof(uint8_t);
+
+    _indexGlyphs();
 }
 
 uint8_t *_lookupGlyph(uint16_t glyph) {
 
-    uint16_t glnr = 0;
+    if (glyph < 256) {
+        uint16_t glnr = glyph_index[glyph];
+        return (glnr == GLYPH_NONE) ? NULL : &pfont.glyphs[glyph_bytes * glnr];
+    }
 
-    uint8_t bwidth = (pfont.gi->bbox.width)/8;
-    if (pfont.gi->bbox.width % 8)
-        bwidth++;
+    /* wider code points walk the ranges */
+    uint16_t glnr = 0;
 
     for(uint16_t i = 0; (uint8_t)pfont.gi->range[i].first != 0 || i == 0; i++) {
         if (glyph >= pfont.gi->range[i].first && glyph <= pfont.gi->range[i].last) {
             glnr += glyph - pfont.gi->range[i].first;
-            return &pfont.glyphs[bwidth * glnr * pfont.gi->pixel_size];
+            return &pfont.glyphs[glyph_bytes * glnr];
         }
         glnr += pfont.gi->range[i].last - pfont.gi->range[i].first + 1;
     }
     return NULL;
 }
 
+static inline bool _glyphBit(const uint8_t *row, uint8_t x) {
+    return row[x / 8] & (0x80 >> (x % 8));
+}
+
 void drawGlyph(uint16_t xx, uint16_t yy, uint16_t c) {
     uint8_t *glyph = _lookupGlyph(c);
 
     if (glyph == NULL)
         return;
 
-    for(uint8_t h = 0; h < pfont.gi->pixel_size; h++) {
-        uint8_t row = 0;
-        for (uint8_t x = 0; x < pfont.gi->bbox.width; x++) {
-            if (x % 8 == 0)
-                row = *glyph++;
-            if (row & ( 1 << (7-(x % 8)))) {
-                ST7735S_Pixel(xx+x, yy+h);
-            } else {
-                if (bg_transparent == false) {
-                    ST7735S_bgPixel(xx+x, yy+h);
-                }
-            }
+    uint8_t width = pfont.gi->bbox.width;
+    uint8_t h0 = 0, h1 = pfont.gi->pixel_size;
+
+#if defined (BANDBUFFER)
+    /* only the rows inside the band being drawn */
+    int32_t top = MAX(band_top - (int32_t)yy, 0);
+    int32_t end = MIN(band_bottom + 1 - (int32_t)yy, (int32_t)h1);
+    if (top >= end)
+        return;
+    h0 = top;
+    h1 = end;
+#endif
+
+    /* runs of set and clear bits go out as fore- and background spans */
+    glyph += h0 * glyph_row_bytes;
+    for (uint8_t h = h0; h < h1; h++, glyph += glyph_row_bytes) {
+        uint8_t x = 0;
+        while (x < width) {
+            bool on = _glyphBit(glyph, x);
+            uint8_t x0 = x;
+            while (++x < width && _glyphBit(glyph, x) == on);
+
+            if (on)
+                ST7735S_Span(xx+x0, yy+h, x-x0);
+            else if (bg_transparent == false)
+                ST7735S_bgSpan(xx+x0, yy+h, x-x0);
         }
     }
+
+    ST7735S_markDirty(xx, yy+h0, xx+width-1, yy+h1-1);
 }
 
 void drawText(uint16_t x, uint16_t y, const char *t) {
+#if defined (BANDBUFFER)
+    /* flush when the text pool is full, longer strings go in pieces */
+    while (!dl_replay && *t) {
+        uint16_t n = MIN(strlen(t), DL_TEXT_BYTES - 1);
+
+        if (dl_count == DL_CMDS || dl_text_used + n + 1 > DL_TEXT_BYTES)
+            flushBuffer();
+
+        dl_cmd_t *c = dlAdd(DL_TEXT, y, y + pfont.gi->pixel_size - 1);
+        c->text.x = x;
+        c->text.y = y;
+        c->text.str = dl_text_used;
+        memcpy(&dl_text[dl_text_used], t, n);
+        dl_text[dl_text_used + n] = '\0';
+        dl_text_used += n + 1;
+
+        x += n * pfont.gi->bbox.width;
+        t += n;
+    }
+    if (!dl_replay)
+        return;
+#endif
     while (*t) {
         drawGlyph(x,y, *t++);
         x += pfont.gi->bbox.width;
@@ -378,6 +687,11 @@ void setColorC(color565_t c) {
     // color.u16 = (c.g << 6 | c.r) << 8 | (c.b << 3 | c.g >> 3);
     color.u[0] = c.u[1];
     color.u[1] = c.u[0];
+#if defined (BANDBUFFER)
+    dl_cmd_t *dc = dlState(DL_COLOR);
+    if (dc != NULL)
+        dc->c = color;
+#endif
 }
 
 void setbgColorC(color565_t c) {
@@ -386,6 +700,11 @@ void setbgColorC(color565_t c) {
     // bg_color.u16 = c.u[0] << 8 | c.u[1];
     bg_color.u[0] = c.u[1];
     bg_color.u[1] = c.u[0];
+#if defined (BANDBUFFER)
+    dl_cmd_t *dc = dlState(DL_BGCOLOR);
+    if (dc != NULL)
+        dc->c = bg_color;
+#endif
 }
 
 void setColor(uint8_t r, uint8_t g, uint8_t b) {
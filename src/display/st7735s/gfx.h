@@ -9,7 +9,7 @@ void setPixel(uint16_t, uint16_t);
 /* background pixel used for font draw */
 void setbgPixel(uint16_t, uint16_t);
 void fillScreen(void);
-/* needs to be the last action when using BUFFER or HVBUFFER */
+/* needs to be the last action when using BUFFER, HVBUFFER or BANDBUFFER */
 void flushBuffer(void);
 void setFont(uint8_t *);
 void drawText(uint16_t, uint16_t, const char *);
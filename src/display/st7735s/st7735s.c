@@ -11,6 +11,7 @@
 /* standard C file */
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
  /* Zephyr files */
 #include <zephyr/kernel.h>
@@ -95,6 +96,19 @@ color565_t hvframe[defWIDTH] = {0};
 color565_t hvcolor1;
 typedef enum { HF, VF, ONE, NONE } hvtype_t;
 hvtype_t hvtype = NONE;
+#elif defined (BANDBUFFER)
+/* wide enough for both orientations, rows are WIDTH apart */
+#define BANDWIDTH MAX(defWIDTH, defHEIGHT)
+/* one strip is on its way to the panel while the next one is drawn */
+static color565_t band_buf[2][BANDWIDTH*BAND_ROWS];
+static color565_t *band = band_buf[0];
+/* strip the last async transfer came from */
+static color565_t *band_sending = NULL;
+/* pixels drawn into the band, the rest of the strip keeps what the panel shows;
+   rows start on a byte so the flush can skip 8 columns at a time */
+#define MASKROW ((BANDWIDTH+7)/8)
+static uint8_t band_mask[MASKROW*BAND_ROWS];
+static uint16_t band_y0 = 0;
 #else
 #error buffer mode not defined
 #endif
@@ -105,6 +119,33 @@ uint16_t XSTART = defXSTART, YSTART = defYSTART;
 uint16_t xmin, xmax, ymin, ymax;
 uint8_t madctl;
 
+#if defined (BUFFER)
+/* dirty regions of the frame, each flushed with its own CASET/RASET window */
+#define DIRTY_RECTS        8
+/* extra pixels worth sending to save a window (CASET + RASET + RAMWR is 11 bytes
+   and 3 DC toggles, plus the per-row transfers of a taller region) */
+#define DIRTY_MERGE_COST   32
+
+typedef struct {
+    uint16_t x0, y0, x1, y1;
+} rect_t;
+
+static rect_t dirty[DIRTY_RECTS];
+static uint8_t dirty_count = 0;
+/* region the last pixel went to, drawing mostly stays inside one */
+static uint8_t dirty_last = 0;
+#endif
+
+#if defined (BANDBUFFER)
+/* windows of a band still growing downwards, more are sent one row high */
+#define BAND_RUNS  16
+
+typedef struct {
+    uint16_t x0, x1;
+    uint16_t r0, r1;    /* band rows */
+} run_t;
+#endif
+
 // uint8_t backlight_pct;
 
 /* colors */
@@ -212,7 +253,85 @@ void setOrientation(rotation_t r) {
 
 void resetWindow(void) {
     xmin = WIDTH - 1; xmax = 0; ymin = HEIGHT - 1; ymax = 0;
+#if defined (BUFFER)
+    dirty_count = 0;
+    dirty_last = 0;
+#endif
+}
+
+#if defined (BUFFER)
+static uint32_t rectArea(const rect_t *r) {
+    return (uint32_t)(r->x1 - r->x0 + 1) * (r->y1 - r->y0 + 1);
+}
+
+static rect_t rectUnion(const rect_t *a, const rect_t *b) {
+    rect_t u = {
+        .x0 = MIN(a->x0, b->x0), .y0 = MIN(a->y0, b->y0),
+        .x1 = MAX(a->x1, b->x1), .y1 = MAX(a->y1, b->y1),
+    };
+    return u;
+}
+
+/* pixels sent in vain when a and b go out as one window instead of two (negative if they overlap) */
+static int32_t mergeCost(const rect_t *a, const rect_t *b) {
+    rect_t u = rectUnion(a, b);
+    return (int32_t)rectArea(&u) - (int32_t)rectArea(a) - (int32_t)rectArea(b);
+}
+
+static void dirtyRemove(uint8_t i) {
+    dirty[i] = dirty[--dirty_count];
+}
+
+/* folds every region that is cheap to combine with region i into it */
+static void dirtyCoalesce(uint8_t i) {
+    bool merged = true;
+
+    while (merged) {
+        merged = false;
+        for (uint8_t j = 0; j < dirty_count; j++) {
+            if (j != i && mergeCost(&dirty[i], &dirty[j]) <= DIRTY_MERGE_COST) {
+                dirty[i] = rectUnion(&dirty[i], &dirty[j]);
+                dirtyRemove(j);
+                if (i == dirty_count) {
+                    i = j;
+                }
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty_last = i;
+}
+
+static void dirtyAdd(const rect_t *p) {
+
+    const rect_t *last = &dirty[dirty_last];
+    if (dirty_count > 0 && p->x0 >= last->x0 && p->x1 <= last->x1 && p->y0 >= last->y0 && p->y1 <= last->y1) {
+        return;
+    }
+
+    /* the region that grows the least, inside one costs nothing */
+    uint8_t best = 0;
+    int32_t best_cost = INT32_MAX;
+    for (uint8_t i = 0; i < dirty_count; i++) {
+        int32_t cost = mergeCost(&dirty[i], p);
+        if (cost < best_cost) {
+            best = i;
+            best_cost = cost;
+        }
+    }
+
+    if (best_cost > DIRTY_MERGE_COST && dirty_count < DIRTY_RECTS) {
+        dirty[dirty_count] = *p;
+        dirty_last = dirty_count++;
+        return;
+    }
+
+    /* a full list grows the cheapest region no matter what */
+    dirty[best] = rectUnion(&dirty[best], p);
+    dirtyCoalesce(best);
 }
+#endif
 
 void updateWindow(uint16_t x, uint16_t y) {
 
@@ -221,8 +340,122 @@ void updateWindow(uint16_t x, uint16_t y) {
         if (x > xmax) xmax = x;
         if (y < ymin) ymin = y;
         if (y > ymax) ymax = y;
+#if defined (BUFFER)
+        const rect_t p = { x, y, x, y };
+        dirtyAdd(&p);
+#endif
+    }
+}
+
+/* CASET/RASET for the window and start a RAMWR into it */
+static void setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+        uint16_t xm = x0 + XSTART, ym = y0 + YSTART;
+        uint16_t xx = x1 + XSTART, yx = y1 + YSTART;
+
+        uint8_t cas[] = { CASET, xm >> 8, xm, xx >> 8, xx };
+        uint8_t ras[] = { RASET, ym >> 8, ym, yx >> 8, yx };
+        uint8_t ram[] = { RAMWR };
+
+        SPI_Transmit(sizeof(cas), cas);
+        SPI_Transmit(sizeof(ras), ras);
+        SPI_TransmitCmd(1, ram);
+}
+
+#if defined (BANDBUFFER)
+void ST7735S_bandStart(uint16_t y0) {
+    band = (band == band_buf[0]) ? band_buf[1] : band_buf[0];
+    if (band == band_sending) {
+        SPI_wait();
+        band_sending = NULL;
+    }
+    band_y0 = y0;
+    memset(band_mask, 0, sizeof(band_mask));
+}
+
+static void bandMark(uint16_t r, uint16_t x, uint16_t n) {
+    uint8_t *m = &band_mask[MASKROW*r];
+
+    for (; n > 0 && x % 8; n--, x++)
+        m[x/8] |= 1 << (x%8);
+    for (; n >= 8; n -= 8, x += 8)
+        m[x/8] = 0xff;
+    for (; n > 0; n--, x++)
+        m[x/8] |= 1 << (x%8);
+}
+
+/* first column from x on whose mask bit is `covered`, WIDTH if there is none */
+static uint16_t bandScan(uint16_t r, uint16_t x, bool covered) {
+    const uint8_t *m = &band_mask[MASKROW*r];
+    const uint8_t skip = covered ? 0x00 : 0xff;
+
+    while (x < WIDTH) {
+        if (x % 8 == 0 && m[x/8] == skip) {
+            x += 8;
+        } else if ((bool)(m[x/8] & (1 << (x%8))) == covered) {
+            return x;
+        } else {
+            x++;
+        }
+    }
+    return WIDTH;
+}
+
+static void bandSend(const run_t *w) {
+    uint16_t len = (w->x1-w->x0+1)*2;
+
+    setWindow(w->x0, band_y0 + w->r0, w->x1, band_y0 + w->r1);
+    /* the last window of a band is sent while the next band is drawn */
+    band_sending = band;
+    SPI_TransmitDataRowsAsync(w->r1-w->r0+1, len, (uint8_t *)&band[WIDTH*w->r0+w->x0], WIDTH*2);
+}
+
+/* sends the drawn pixels of the band; a run of drawn pixels continues the window
+   of the row above when it spans the same columns, so filled areas and opaque
+   text go out as one window and sparse drawing never overwrites its gaps */
+static void bandFlush(void) {
+    run_t open[BAND_RUNS];
+    uint8_t n_open = 0;
+    uint16_t rows = MIN(BAND_ROWS, HEIGHT - band_y0);
+
+    for (uint16_t r = 0; r < rows; r++) {
+        uint16_t x = 0;
+
+        while ((x = bandScan(r, x, true)) < WIDTH) {
+            uint16_t x0 = x;
+            x = bandScan(r, x, false);
+
+            uint8_t i;
+            for (i = 0; i < n_open; i++)
+                if (open[i].x0 == x0 && open[i].x1 == x-1 && open[i].r1 + 1 == r)
+                    break;
+
+            if (i < n_open) {
+                open[i].r1 = r;
+            } else if (n_open < BAND_RUNS) {
+                open[n_open++] = (run_t){ x0, x-1, r, r };
+            } else {
+                run_t w = { x0, x-1, r, r };
+                bandSend(&w);
+            }
+        }
+
+        /* windows this row did not continue are complete */
+        for (uint8_t i = 0; i < n_open; ) {
+            if (open[i].r1 != r) {
+                bandSend(&open[i]);
+                open[i] = open[--n_open];
+            } else {
+                i++;
+            }
+        }
     }
+
+    for (uint8_t i = 0; i < n_open; i++)
+        bandSend(&open[i]);
+
+    memset(band_mask, 0, sizeof(band_mask));
 }
+#endif
 
 void ST7735S_Init(void) {
     // initialize SPI (and GPIO pins)
@@ -251,27 +484,17 @@ void ST7735S_Init(void) {
 }
 
 void ST7735S_flush(void) {
-        uint16_t xm = xmin + XSTART, ym = ymin + YSTART;
-        uint16_t xx = xmax + XSTART, yx = ymax + YSTART;
-
-        uint8_t cas[] = { CASET, xm >> 8, xm, xx >> 8, xx };
-        uint8_t ras[] = { RASET, ym >> 8, ym, yx >> 8, yx };
-        uint8_t ram[] = { RAMWR };
-
-        SPI_Transmit(sizeof(cas), cas);
-        SPI_Transmit(sizeof(ras), ras);
-        SPI_TransmitCmd(1, ram);
-
         #if defined(BUFFER)
-        #if 1
-            uint16_t len  = (xmax-xmin+1)*2;
-            for (uint16_t y = ymin; y <= ymax; y++)
-                SPI_TransmitData(len, (uint8_t *)&frame[WIDTH*y+xmin]);
-        #else
-            uint16_t len = (xmax-xmin+1)*2*(ymax-ymin+1);
-            SPI_TransmitData(len, (uint8_t *)&frame[WIDTH*ymin+xmin]);
-        #endif
+            for (uint8_t i = 0; i < dirty_count; i++) {
+                const rect_t *r = &dirty[i];
+                uint16_t len  = (r->x1-r->x0+1)*2;
+
+                setWindow(r->x0, r->y0, r->x1, r->y1);
+                /* full width rows are contiguous and go out as one buffer */
+                SPI_TransmitDataRows(r->y1-r->y0+1, len, (uint8_t *)&frame[WIDTH*r->y0+r->x0], WIDTH*2);
+            }
         #elif defined(HVBUFFER)
+            setWindow(xmin, ymin, xmax, ymax);
             if (hvtype == VF) { // horiz line
                 uint16_t len  = (xmax-xmin+1)*2;
                 SPI_TransmitData(len, (uint8_t *)&hvframe[xmin]);
@@ -284,7 +507,10 @@ void ST7735S_flush(void) {
                     SPI_TransmitData(2, (uint8_t *)&hvcolor1);
                 }
             hvtype = NONE;
+        #elif defined(BANDBUFFER)
+            bandFlush();
         #elif defined(BUFFER1)
+            setWindow(xmin, ymin, xmax, ymax);
             SPI_TransmitData( 2, (uint8_t *)&frame[0]);
         #else
         #error buffer not defined.
@@ -306,6 +532,35 @@ void ST7735S_bgPixel(uint16_t x, uint16_t y) {
         updateWindow(x,y);
     }
 }
+
+static void frameSpan(uint16_t x, uint16_t y, uint16_t len, color565_t c) {
+    if ( x < WIDTH && y < HEIGHT) {
+        color565_t *p = &frame[WIDTH*y+x];
+        for (uint16_t n = MIN(len, WIDTH - x); n > 0; n--)
+            *p++ = c;
+    }
+}
+
+void ST7735S_Span(uint16_t x, uint16_t y, uint16_t len) {
+    frameSpan(x, y, len, color);
+}
+
+void ST7735S_bgSpan(uint16_t x, uint16_t y, uint16_t len) {
+    frameSpan(x, y, len, bg_color);
+}
+
+void ST7735S_markDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    if (x0 >= WIDTH || y0 >= HEIGHT)
+        return;
+
+    rect_t r = { x0, y0, MIN(x1, WIDTH - 1), MIN(y1, HEIGHT - 1) };
+
+    if (r.x0 < xmin) xmin = r.x0;
+    if (r.x1 > xmax) xmax = r.x1;
+    if (r.y0 < ymin) ymin = r.y0;
+    if (r.y1 > ymax) ymax = r.y1;
+    dirtyAdd(&r);
+}
 #elif defined(HVBUFFER)
 void set_hvpixel(uint16_t x, uint16_t y) {
 	// first pixel
@@ -371,6 +626,45 @@ void ST7735S_bgPixel(uint16_t x, uint16_t y) {
     }
 }
 
+#elif defined(BANDBUFFER)
+static void bandPixel(uint16_t x, uint16_t y, color565_t c) {
+    if ( x < WIDTH && y < HEIGHT && y >= band_y0 && y - band_y0 < BAND_ROWS) {
+        band[WIDTH*(y-band_y0) + x] = c;
+        band_mask[MASKROW*(y-band_y0) + x/8] |= 1 << (x%8);
+    }
+}
+
+void ST7735S_Pixel(uint16_t x, uint16_t y) {
+    bandPixel(x, y, color);
+}
+
+void ST7735S_bgPixel(uint16_t x, uint16_t y) {
+    bandPixel(x, y, bg_color);
+}
+
+static void bandSpan(uint16_t x, uint16_t y, uint16_t len, color565_t c) {
+    if ( x < WIDTH && y < HEIGHT && y >= band_y0 && y - band_y0 < BAND_ROWS) {
+        uint16_t n = MIN(len, WIDTH - x);
+        color565_t *p = &band[WIDTH*(y-band_y0) + x];
+
+        for (uint16_t i = 0; i < n; i++)
+            p[i] = c;
+        bandMark(y - band_y0, x, n);
+    }
+}
+
+void ST7735S_Span(uint16_t x, uint16_t y, uint16_t len) {
+    bandSpan(x, y, len, color);
+}
+
+void ST7735S_bgSpan(uint16_t x, uint16_t y, uint16_t len) {
+    bandSpan(x, y, len, bg_color);
+}
+
+/* the mask already has every pixel */
+void ST7735S_markDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+}
+
 #elif defined(BUFFER1)
 void ST7735S_Pixel(uint16_t x, uint16_t y) {
     if ( x < WIDTH && y < HEIGHT) {
@@ -389,6 +683,22 @@ void ST7735S_bgPixel(uint16_t x, uint16_t y) {
 }
 #endif
 
+#if defined(HVBUFFER) || defined(BUFFER1)
+/* no frame to write into, spans go out pixel by pixel */
+void ST7735S_Span(uint16_t x, uint16_t y, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++)
+        ST7735S_Pixel(x + i, y);
+}
+
+void ST7735S_bgSpan(uint16_t x, uint16_t y, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++)
+        ST7735S_bgPixel(x + i, y);
+}
+
+void ST7735S_markDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+}
+#endif
+
 bool ST7735S_defineScrollArea(uint16_t x, uint16_t x2) {
 
     /* tfa: top fixed area: nr of line from top of the frame mem and display) */
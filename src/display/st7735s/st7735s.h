@@ -12,7 +12,7 @@ extern "C" {
 #include "st7735s_compat.h"
 
 /* undef if low on mem */
-#if !defined (BUFFER) && !defined (BUFFER1) && !defined (HVBUFFER)
+#if !defined (BUFFER) && !defined (BUFFER1) && !defined (HVBUFFER) && !defined (BANDBUFFER)
   #warning no buffer defined, defining BUFFER1
   #define BUFFER1
 #endif
@@ -43,6 +43,15 @@ void ST7735S_Init(void);
 void ST7735S_flush(void);
 void ST7735S_Pixel(uint16_t x, uint16_t y);
 void ST7735S_bgPixel(uint16_t x, uint16_t y);
+/* len pixels from x,y to the right in the fore-/background color; unlike the pixel
+   functions these leave the flush window alone, mark it with ST7735S_markDirty() */
+void ST7735S_Span(uint16_t x, uint16_t y, uint16_t len);
+void ST7735S_bgSpan(uint16_t x, uint16_t y, uint16_t len);
+void ST7735S_markDirty(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+#if defined (BANDBUFFER)
+/* only rows y0 .. y0+BAND_ROWS-1 are kept until the next ST7735S_flush() */
+void ST7735S_bandStart(uint16_t y0);
+#endif
 void setOrientation(rotation_t r);
 void ST7735S_sleepIn(void);
 void ST7735S_sleepOut(void);
@@ -39,6 +39,16 @@ static const struct gpio_dt_spec rs_dt = GPIO_DT_SPEC_GET(DISP0_NODE, reset_gpio
 /* Backlight tracking */
 uint8_t backlight_pct = 100;
 
+/* Bus gate: taken for every transfer, an async one gives it back from its callback.
+   DC must not change before the pixel data is out, so commands wait here too. */
+static K_SEM_DEFINE(spi_idle, 1, 1);
+static bool spi_async = true;
+#if defined(CONFIG_SPI_ASYNC)
+static uint32_t spi_async_start;
+#endif
+
+spi_stats_t spi_stats;
+
 /* SPI Initialization */
 void SPI_Init_ST7735(void) {
     if (!spi_is_ready_dt(&spi_dev)) {
@@ -86,7 +96,29 @@ void Pin_BLK_Pct(uint8_t pct) {
     }
 }
 
+static void SPI_acquire(void) {
+    uint32_t t0 = k_cycle_get_32();
+    k_sem_take(&spi_idle, K_FOREVER);
+    spi_stats.wait_cycles += k_cycle_get_32() - t0;
+}
+
+static void SPI_release(void) {
+    k_sem_give(&spi_idle);
+}
+
 /* SPI Communication */
+
+/* blocking write of a whole set, the caller waits for all of it */
+static void SPI_write(const struct spi_buf_set *set) {
+    uint32_t t0 = k_cycle_get_32();
+    spi_write_dt(&spi_dev, set);
+    uint32_t t = k_cycle_get_32() - t0;
+
+    spi_stats.transfers++;
+    spi_stats.bus_cycles += t;
+    spi_stats.wait_cycles += t;
+}
+
 // TODO (small): can I combine this one with the other display transport layers?
 void SPI_send(uint16_t len, uint8_t *data) {
     struct spi_buf buf = {
@@ -98,17 +130,88 @@ void SPI_send(uint16_t len, uint8_t *data) {
         .count = 1,
     };
 
-    spi_write_dt(&spi_dev, &set);
+    SPI_write(&set);
 }
 
 void SPI_TransmitCmd(uint16_t len, uint8_t *data) {
+    SPI_acquire();
     Pin_DC_Low();
     SPI_send(len, data);
+    SPI_release();
 }
 
 void SPI_TransmitData(uint16_t len, uint8_t *data) {
+    SPI_acquire();
     Pin_DC_High();
     SPI_send(len, data);
+    SPI_release();
+}
+
+#if defined(CONFIG_SPI_ASYNC)
+/* ISR context */
+static void SPI_asyncDone(const struct device *dev, int result, void *user) {
+    spi_stats.bus_cycles += k_cycle_get_32() - spi_async_start;
+    SPI_release();
+}
+#endif
+
+/* rows of a window as one transaction: DC, CS and the driver setup once per window
+   instead of once per row. The descriptors are static, an async transfer keeps
+   pointing at them until its callback; the bus gate makes them single user. */
+static void SPI_rows(uint16_t rows, uint16_t len, uint8_t *data, uint16_t stride, bool async) {
+    static struct spi_buf row_buf[SPI_ROWS_MAX];
+    static struct spi_buf_set row_set = { .buffers = row_buf };
+
+    while (rows > 0) {
+        /* contiguous rows are one buffer, taller windows than the table go out in parts */
+        uint16_t n = (stride == len) ? rows : MIN(rows, SPI_ROWS_MAX);
+
+        SPI_acquire();
+        if (stride == len) {
+            row_buf[0] = (struct spi_buf){ .buf = data, .len = (size_t)len * n };
+            row_set.count = 1;
+        } else {
+            for (uint16_t r = 0; r < n; r++)
+                row_buf[r] = (struct spi_buf){ .buf = data + (size_t)stride * r, .len = len };
+            row_set.count = n;
+        }
+        Pin_DC_High();
+
+#if defined(CONFIG_SPI_ASYNC)
+        if (async && spi_async && n == rows) {
+            spi_async_start = k_cycle_get_32();
+            if (spi_transceive_cb(spi_dev.bus, &spi_dev.config, &row_set, NULL, SPI_asyncDone, NULL) == 0) {
+                spi_stats.transfers++;
+                spi_stats.async_transfers++;
+                return;
+            }
+            /* not started, send it the blocking way */
+        }
+#endif
+        SPI_write(&row_set);
+        SPI_release();
+
+        rows -= n;
+        data += (size_t)stride * n;
+    }
+}
+
+void SPI_TransmitDataRows(uint16_t rows, uint16_t len, uint8_t *data, uint16_t stride) {
+    SPI_rows(rows, len, data, stride, false);
+}
+
+void SPI_TransmitDataRowsAsync(uint16_t rows, uint16_t len, uint8_t *data, uint16_t stride) {
+    SPI_rows(rows, len, data, stride, true);
+}
+
+void SPI_wait(void) {
+    SPI_acquire();
+    SPI_release();
+}
+
+void SPI_asyncEnable(bool on) {
+    SPI_wait();
+    spi_async = on;
 }
 
 void SPI_Transmit(uint16_t len, uint8_t *data) {
@@ -2,6 +2,7 @@
 #define __st7735s_compat_h__
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 /* this may differ from the default 80x160 */
 #define defWIDTH   128
@@ -15,6 +16,19 @@
 /* BUFFER1: slowest, used for limited RAM */
 #define BUFFER1
 
+/* BANDBUFFER: gfx calls are recorded and replayed once per BAND_ROWS high strip of
+   the screen, each strip is flushed from a small buffer before the next is drawn.
+   Costs about 14 KB more than BUFFER1 (two 180x16 strips and the display list) */
+// #define BANDBUFFER
+#define BAND_ROWS  16
+
+/* row descriptors of one SPI transaction, the tallest window a flush sends */
+#if defined (BANDBUFFER)
+#define SPI_ROWS_MAX  BAND_ROWS
+#else
+#define SPI_ROWS_MAX  ((defWIDTH > defHEIGHT) ? defWIDTH : defHEIGHT)
+#endif
+
 /*HVBUFFER: takes advantage of writing adjacent same color pixels*/
 // #define HVBUFFER
 
@@ -35,6 +49,23 @@ void SPI_send(uint16_t len, uint8_t *data);
 void SPI_TransmitCmd(uint16_t len, uint8_t *data);
 void SPI_TransmitData(uint16_t len, uint8_t *data);
 void SPI_Transmit(uint16_t len, uint8_t *data);
+/* `rows` rows of `len` bytes, `stride` bytes apart, as one transaction */
+void SPI_TransmitDataRows(uint16_t rows, uint16_t len, uint8_t *data, uint16_t stride);
+/* returns once the transfer started, `data` must stay untouched until SPI_wait()
+   or the next transfer; blocking without CONFIG_SPI_ASYNC */
+void SPI_TransmitDataRowsAsync(uint16_t rows, uint16_t len, uint8_t *data, uint16_t stride);
+void SPI_wait(void);
+void SPI_asyncEnable(bool);
+
+/* bus time and the part of it the caller spent blocked, in cycles */
+typedef struct {
+    uint32_t transfers;
+    uint32_t async_transfers;
+    uint64_t bus_cycles;
+    uint64_t wait_cycles;
+} spi_stats_t;
+
+extern spi_stats_t spi_stats;
 
 /* Backlight level */
 extern uint8_t backlight_pct;
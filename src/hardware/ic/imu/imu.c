@@ -29,10 +29,13 @@
 #include <peripheral/interrupt.h>
 #include <circular_buffer.h>
 #include <memory/nvs.h>
+#include <memory/archive.h>
 #include <clock.h>
 
 /* IMU header files*/
 #include <imu.h>
+#include <imu_codec.h>
+#include <imu_rollup.h>
 
 #ifdef USE_DERS_IMU
     #include <ICM_42670.h>
@@ -49,12 +52,24 @@ uint8_t irq_received = 0;
 
 Circular_Buffer * imu_data_buffer = NULL;
 
+// the button handler fills the buffer from the FIFO while the logging thread drains it
+static K_MUTEX_DEFINE(imu_buffer_lock);
+
 volatile uint32_t step_count;
 
 
 #define FLASH_INTEGRITY_WRITE_CYCLE              10
 int flash_write_num = 0;
 
+// samples are packed into codec blocks; a full block becomes one archive record
+static imu_codec_enc_t imu_enc;
+static uint8_t imu_block[IMU_CODEC_MAX_BLOCK_BYTES];
+static uint32_t imu_block_ts;
+
+// sample times continue from the archive clock, the uptime alone restarts at every boot
+static uint32_t imu_ts_base;
+static int64_t imu_ts_boot;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //! -----------------------------------------------------------------------------------------------------------------------//
@@ -75,6 +90,19 @@ int imu_init() {
     // LOG_INF("buffer_end = [%d]", imu_data_buffer->buffer_end);
 
 
+    if (IMU_LOG_TO_FLASH) {
+        // the FIFO event callback fills this buffer, imu_process() drains it
+        imu_data_buffer = circular_buffer_init(200, sizeof(inv_imu_sensor_event_t));
+        if (imu_data_buffer == NULL) {
+            return -ENOMEM;
+        }
+
+        imu_ts_base = archive_get_clock();
+        imu_ts_boot = k_uptime_get();
+        imu_codec_enc_init(&imu_enc, IMU_ODR_HZ);
+        imu_rollup_init();
+    }
+
     int rc = 0;
     #ifdef USE_DERS_IMU
         // do rough init
@@ -131,10 +159,10 @@ int imu_start() {
     int rc = 0;
 
     LOG_INF("Starting accel...");
-    rc |= startAccel(100, 16);     // ODR=100 Hz, full-scale range=16
+    rc |= startAccel(IMU_ODR_HZ, 16);     // full-scale range=16
 
     LOG_INF("Starting gyro...");
-    rc |= startGyro(100, 2000);    // ODR=100 Hz, full-scale range=2000 dps
+    rc |= startGyro(IMU_ODR_HZ, 2000);    // full-scale range=2000 dps
 
     return rc;
 }
@@ -165,11 +193,29 @@ int imu_fifo_interrupt() {
  */
 inv_imu_sensor_event_t  imu_deque() {
     inv_imu_sensor_event_t event;
+    k_mutex_lock(&imu_buffer_lock, K_FOREVER);
     circular_buffer_remove(imu_data_buffer, &event);
+    k_mutex_unlock(&imu_buffer_lock);
     return event;
 }
 
 
+/*
+ * imu_take: removes the oldest buffered event, false once the buffer is empty
+ *
+ * The lock is only held for the copy so the FIFO reader is never stuck behind a flash write.
+ */
+static bool imu_take(inv_imu_sensor_event_t *event) {
+    k_mutex_lock(&imu_buffer_lock, K_FOREVER);
+    bool taken = !circular_buffer_empty(imu_data_buffer);
+    if (taken) {
+        circular_buffer_remove(imu_data_buffer, event);
+    }
+    k_mutex_unlock(&imu_buffer_lock);
+    return taken;
+}
+
+
 /*
  * imu_process: this function currently processes the circular buffers of raw data
  */
@@ -178,34 +224,54 @@ inv_imu_sensor_event_t  imu_deque() {
 void imu_process() {
     inv_imu_sensor_event_t event;
 
-    if (!circular_buffer_empty(imu_data_buffer)) {
-        // get current buffer count
-        /* size_t buf_count = circular_buffer_get_count(imu_data_buffer); */
-        /* LOG_INF(display, 0, 0, "buf count: [%d]\n", buf_count); */
+    // get current buffer count
+    /* size_t buf_count = circular_buffer_get_count(imu_data_buffer); */
+    /* LOG_INF(display, 0, 0, "buf count: [%d]\n", buf_count); */
+
+    while (imu_take(&event)) {
+        event_print(&event);
 
-        while (!circular_buffer_empty(imu_data_buffer)) {
-            circular_buffer_remove(imu_data_buffer, &event);
-            event_print(&event);
+        if (IMU_LOG_TO_FLASH) {
+            write_to_flash(&event);
         }
     }
 } // end of function
 
 
 
-void write_to_flash() {
-/* if (flash_write_num % FLASH_INTEGRITY_WRITE_CYCLE == 0) { */
-/*     uint8_t flash_cycle_pad = 0xD8; */
-/*     status = nvs_write_auto_offset(&flash_cycle_pad, 1); */
-/*     LOG_INF(display, 0, 0, "\tFlash cycle integrity write. Write status: [%d]", status); */
-//////////////////////////////////////////////
-// WRITE TO FLASH MEMORY /////////////////////
-//////////////////////////////////////////////
-/*     status = nvs_write_auto_offset(&a_x, 2); */
-/*     if (status != 0) { */
-/*         LOG_INF(display, 0, 0, "\tERROR: NVS write for the IMU got status: [%d]", status); */
-/*         nvs_error(status, 0, display); */
-/*     } */
-        /*     flash_write_num++; */
+/*
+ * write_to_flash: packs an IMU event into the current codec block and archives full blocks
+ *
+ * Sample times are implied by the ODR, so a block only stores the time of its first sample.
+ * They count in ms from the archive clock recovered at init, so the log keeps its time order
+ * across reboots.
+ * The same sample also feeds the per-second/minute/hour rollups.
+ */
+void write_to_flash(const inv_imu_sensor_event_t *evt) {
+    if (imu_enc.count == 0) {
+        imu_block_ts = imu_ts_base + (uint32_t)(k_uptime_get() - imu_ts_boot);
+    }
+
+    imu_sample_t sample = {
+        .accel = { evt->accel[0], evt->accel[1], evt->accel[2] },
+#if ICM_IS_GYRO_SUPPORTED
+        .gyro = { evt->gyro[0], evt->gyro[1], evt->gyro[2] },
+#endif
+        .temperature = evt->temperature,
+    };
+
+    imu_rollup_add(imu_block_ts + imu_enc.count * 1000 / IMU_ODR_HZ, &sample, step_count);
+
+    size_t len = imu_codec_enc_push(&imu_enc, &sample, imu_block);
+    if (len == 0) {
+        return;
+    }
+
+    int status = archive_append(ARCHIVE_STREAM_RAW, imu_block_ts, imu_block, len);
+    if (status != 0) {
+        LOG_ERR("archive write for the IMU got status: [%d]", status);
+    }
+    flash_write_num++;
 }
 
 
@@ -238,7 +304,9 @@ void get_fifo_data() {
     LOG_INF("IMU FIFO retrieve");
 
     inv_imu_sensor_event_t imu_event;
+    k_mutex_lock(&imu_buffer_lock, K_FOREVER);
     int fifo_status = getDataFromFifo(&imu_event);
+    k_mutex_unlock(&imu_buffer_lock);
     LOG_INF("\tgot FIFO read status [%d] (0 is GOOD)", fifo_status);
     LOG_INF("... done with IMU FIFO retrieve!");
 }
@@ -30,6 +30,16 @@
 #define IMU_APEX_ENABLED     0
 #define IMU_FIFO_WM          50
 
+// accel and gyro sample rate
+#define IMU_ODR_HZ           100
+
+// encode drained samples into the flash archive (needs nvs_init() and archive_init() first)
+#ifdef CONFIG_IMU_LOG_TO_FLASH
+#define IMU_LOG_TO_FLASH     1
+#else
+#define IMU_LOG_TO_FLASH     0
+#endif
+
 
 extern Circular_Buffer *imu_data_buffer;
 
@@ -66,10 +76,18 @@ inv_imu_sensor_event_t imu_deque();
 
 /**
  * @brief processes from the IMU receive buffer
+ *
+ * Runs in the IMU logging thread, the archive write path needs its larger stack
  */
 void imu_process();
 
 
+/**
+ * @brief packs one IMU event into the compressed flash log
+ */
+void write_to_flash(const inv_imu_sensor_event_t *evt);
+
+
 /**
  * @brief function for polling the register data of the IMU
  */
@@ -0,0 +1,277 @@
+//*****************************************************************************
+//!
+//! @file imu_codec.c
+//! @author Anders Bandt
+//! @brief Delta + bit-packing codec for storing the IMU sample stream in flash
+//! @version 0.9
+//! @date October 2026
+//!
+//! Every channel of a block is stored as its first value followed by either the
+//! sample-to-sample deltas or the delta-of-deltas, whichever packs narrower. The
+//! residuals are zig-zagged and bit-packed at one fixed width per channel and
+//! block. Timestamps are not stored: the block carries the ODR and its first
+//! sample time lives in the archive record.
+//!
+//*****************************************************************************
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+
+/* My header files  */
+#include <imu_codec.h>
+
+
+/* channels are read as an int16_t array */
+BUILD_ASSERT(sizeof(imu_sample_t) == IMU_CODEC_CHANNELS * sizeof(int16_t), "imu_sample_t must not be padded");
+
+#define WIDTH_BITS  5
+
+
+/**
+ * @brief LSB-first bit writer
+ */
+typedef struct bit_writer {
+    uint8_t *out;
+    size_t pos;
+    uint32_t acc;
+    uint8_t bits;
+} bit_writer_t;
+
+
+/**
+ * @brief LSB-first bit reader, flags a read past the end
+ */
+typedef struct bit_reader {
+    const uint8_t *in;
+    size_t len;
+    size_t pos;
+    uint32_t acc;
+    uint8_t bits;
+    bool overrun;
+} bit_reader_t;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int16_t imu_codec_channel(const imu_sample_t *sample, uint8_t ch)
+{
+    return ((const int16_t *)sample)[ch];
+}
+
+
+static inline uint32_t imu_codec_zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+
+static inline int32_t imu_codec_unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+
+static inline uint8_t imu_codec_width(uint32_t v)
+{
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+
+/* bit_put: appends the low `n` bits of `v` (n <= 24) */
+static inline void bit_put(bit_writer_t *w, uint32_t v, uint8_t n)
+{
+    w->acc |= v << w->bits;
+    w->bits += n;
+
+    while (w->bits >= 8) {
+        w->out[w->pos++] = (uint8_t)w->acc;
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+
+/* bit_get: reads the next `n` bits (n <= 24) */
+static inline uint32_t bit_get(bit_reader_t *r, uint8_t n)
+{
+    while (r->bits < n) {
+        if (r->pos >= r->len) {
+            r->overrun = true;
+            return 0;
+        }
+        r->acc |= (uint32_t)r->in[r->pos++] << r->bits;
+        r->bits += 8;
+    }
+
+    uint32_t v = r->acc & ((1u << n) - 1);
+    r->acc >>= n;
+    r->bits -= n;
+    return v;
+}
+
+
+/*
+ * imu_codec_encode: packs the buffered samples into `out` and empties the encoder
+ */
+static size_t imu_codec_encode(imu_codec_enc_t *enc, uint8_t *out)
+{
+    const uint8_t n = enc->count;
+    const imu_sample_t *s = enc->samples;
+
+    bool dod[IMU_CODEC_CHANNELS];
+    uint8_t width[IMU_CODEC_CHANNELS];
+
+    bit_writer_t w = { .out = out };
+
+    bit_put(&w, n, 8);
+    bit_put(&w, enc->odr_hz, 16);
+
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        bit_put(&w, (uint16_t)imu_codec_channel(&s[0], ch), 16);
+    }
+
+    /* pick delta or delta-of-delta per channel; OR-ing the residuals gives the max width */
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        uint32_t bits_d = 0;
+        uint32_t bits_dd = 0;
+        int32_t prev_d = 0;
+
+        for (uint8_t i = 1; i < n; i++) {
+            int32_t d = imu_codec_channel(&s[i], ch) - imu_codec_channel(&s[i - 1], ch);
+            bits_d |= imu_codec_zigzag(d);
+            bits_dd |= imu_codec_zigzag(d - prev_d);
+            prev_d = d;
+        }
+
+        dod[ch] = imu_codec_width(bits_dd) < imu_codec_width(bits_d);
+        width[ch] = imu_codec_width(dod[ch] ? bits_dd : bits_d);
+
+        bit_put(&w, dod[ch], 1);
+        bit_put(&w, width[ch], WIDTH_BITS);
+    }
+
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        if (width[ch] == 0) {
+            continue;
+        }
+
+        int32_t prev_d = 0;
+        for (uint8_t i = 1; i < n; i++) {
+            int32_t d = imu_codec_channel(&s[i], ch) - imu_codec_channel(&s[i - 1], ch);
+            bit_put(&w, imu_codec_zigzag(dod[ch] ? d - prev_d : d), width[ch]);
+            prev_d = d;
+        }
+    }
+
+    /* flush the last partial byte */
+    if (w.bits > 0) {
+        bit_put(&w, 0, 8 - w.bits);
+    }
+
+    enc->count = 0;
+    return w.pos;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL FUNCTIONS ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void imu_codec_enc_init(imu_codec_enc_t *enc, uint16_t odr_hz)
+{
+    enc->count = 0;
+    enc->odr_hz = odr_hz;
+}
+
+
+/*
+ * imu_codec_enc_push: buffers a sample and encodes the block once it is full
+ */
+size_t imu_codec_enc_push(imu_codec_enc_t *enc, const imu_sample_t *sample, uint8_t *out)
+{
+    enc->samples[enc->count++] = *sample;
+
+    if (enc->count < IMU_CODEC_BLOCK_SAMPLES) {
+        return 0;
+    }
+
+    return imu_codec_encode(enc, out);
+}
+
+
+/*
+ * imu_codec_enc_flush: encodes whatever is buffered
+ */
+size_t imu_codec_enc_flush(imu_codec_enc_t *enc, uint8_t *out)
+{
+    if (enc->count == 0) {
+        return 0;
+    }
+
+    return imu_codec_encode(enc, out);
+}
+
+
+/*
+ * imu_codec_decode: unpacks one block
+ */
+int imu_codec_decode(const uint8_t *in, size_t len, imu_sample_t *samples, uint16_t *odr_hz)
+{
+    bit_reader_t r = { .in = in, .len = len };
+
+    const uint8_t n = bit_get(&r, 8);
+    const uint16_t odr = bit_get(&r, 16);
+
+    if (n == 0 || n > IMU_CODEC_BLOCK_SAMPLES) {
+        return -EBADMSG;
+    }
+
+    int16_t *first = (int16_t *)&samples[0];
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        first[ch] = (int16_t)bit_get(&r, 16);
+    }
+
+    bool dod[IMU_CODEC_CHANNELS];
+    uint8_t width[IMU_CODEC_CHANNELS];
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        dod[ch] = bit_get(&r, 1);
+        width[ch] = bit_get(&r, WIDTH_BITS);
+
+        if (width[ch] > IMU_CODEC_MAX_WIDTH) {
+            return -EBADMSG;
+        }
+    }
+
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        int32_t prev_d = 0;
+
+        for (uint8_t i = 1; i < n; i++) {
+            int32_t v = width[ch] ? imu_codec_unzigzag(bit_get(&r, width[ch])) : 0;
+            int32_t d = dod[ch] ? prev_d + v : v;
+
+            ((int16_t *)&samples[i])[ch] = (int16_t)(imu_codec_channel(&samples[i - 1], ch) + d);
+            prev_d = d;
+        }
+    }
+
+    if (r.overrun) {
+        return -EBADMSG;
+    }
+
+    if (odr_hz) {
+        *odr_hz = odr;
+    }
+
+    return n;
+}
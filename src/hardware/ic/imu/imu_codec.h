@@ -0,0 +1,95 @@
+//*****************************************************************************
+//!
+//! @file imu_codec.h
+//! @author Anders Bandt
+//! @brief Delta + bit-packing codec for storing the IMU sample stream in flash
+//! @version 0.9
+//! @date October 2026
+//!
+//*****************************************************************************
+
+#ifndef SRC_IC_IMU_IMU_CODEC_H_
+#define SRC_IC_IMU_IMU_CODEC_H_
+
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* accel x/y/z, gyro x/y/z, temperature */
+#define IMU_CODEC_CHANNELS        7
+
+/* samples per encoded block; every block decodes on its own */
+#define IMU_CODEC_BLOCK_SAMPLES   32
+
+/* widest residual: zig-zagged delta-of-delta of an int16 channel */
+#define IMU_CODEC_MAX_WIDTH       18
+
+/*
+ * Block layout (bits are packed LSB first):
+ *     count (8), ODR in Hz (16), first sample of every channel (7 x 16),
+ *     per channel: mode (1, delta or delta-of-delta) + width (5),
+ *     per channel: (count - 1) residuals of `width` bits
+ */
+#define IMU_CODEC_MAX_BLOCK_BYTES \
+    (3 + 2 * IMU_CODEC_CHANNELS + \
+     (IMU_CODEC_CHANNELS * 6 + IMU_CODEC_CHANNELS * (IMU_CODEC_BLOCK_SAMPLES - 1) * IMU_CODEC_MAX_WIDTH + 7) / 8)
+
+
+/**
+ * @brief one IMU sample as stored; the timestamp is implied by the ODR
+ */
+typedef struct imu_sample {
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temperature;
+} imu_sample_t;
+
+
+/**
+ * @brief encoder state, one block of samples (no heap use)
+ */
+typedef struct imu_codec_enc {
+    imu_sample_t samples[IMU_CODEC_BLOCK_SAMPLES];
+    uint8_t count;
+    uint16_t odr_hz;
+} imu_codec_enc_t;
+
+
+/**
+ * @brief resets the encoder for a stream sampled at `odr_hz`
+ */
+void imu_codec_enc_init(imu_codec_enc_t *enc, uint16_t odr_hz);
+
+
+/**
+ * @brief adds one sample, encoding the block once it is full
+ *
+ * @param[out]  out   at least IMU_CODEC_MAX_BLOCK_BYTES
+ *
+ * @return number of bytes written to `out` (0 while the block is still filling)
+ */
+size_t imu_codec_enc_push(imu_codec_enc_t *enc, const imu_sample_t *sample, uint8_t *out);
+
+
+/**
+ * @brief encodes a partial block, e.g. before a gap in the sample stream
+ *
+ * @return number of bytes written to `out` (0 if the block was empty)
+ */
+size_t imu_codec_enc_flush(imu_codec_enc_t *enc, uint8_t *out);
+
+
+/**
+ * @brief decodes one block
+ *
+ * @param[out]  samples   at least IMU_CODEC_BLOCK_SAMPLES entries
+ * @param[out]  odr_hz    sample rate of the block (may be NULL)
+ *
+ * @return number of samples, or -EBADMSG for a truncated or malformed block
+ */
+int imu_codec_decode(const uint8_t *in, size_t len, imu_sample_t *samples, uint16_t *odr_hz);
+
+
+#endif /* SRC_IC_IMU_IMU_CODEC_H_ */
@@ -0,0 +1,269 @@
+//*****************************************************************************
+//!
+//! @file imu_rollup.c
+//! @author Anders Bandt
+//! @brief Per-second/minute/hour aggregates of the IMU stream, archived beside the raw data
+//! @version 0.9
+//! @date October 2026
+//!
+//! Only the second level sees samples. When a window closes it is written to its
+//! archive stream and merged into the open window of the next level, so a minute
+//! costs 60 merges and an hour 60 more. History screens then read a handful of
+//! rollup pages instead of decoding the raw stream.
+//!
+//*****************************************************************************
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+/* My header files  */
+#include <memory/archive.h>
+#include <imu_rollup.h>
+
+
+LOG_MODULE_REGISTER(imu_rollup, LOG_LEVEL_INF);
+
+
+/**
+ * @brief open window of one level
+ */
+typedef struct rollup_acc {
+    uint32_t start_ts;
+    uint32_t count;
+    uint32_t steps;
+    int16_t min[IMU_CODEC_CHANNELS];
+    int16_t max[IMU_CODEC_CHANNELS];
+    int64_t sum[IMU_CODEC_CHANNELS];
+} rollup_acc_t;
+
+
+static const uint32_t window_ms[IMU_ROLLUP_LEVELS] = IMU_ROLLUP_WINDOWS_MS;
+static const uint32_t deadline_ms[IMU_ROLLUP_LEVELS] = IMU_ROLLUP_DEADLINES_MS;
+
+static const uint8_t level_stream[IMU_ROLLUP_LEVELS] = {
+    ARCHIVE_STREAM_ROLLUP_SEC,
+    ARCHIVE_STREAM_ROLLUP_MIN,
+    ARCHIVE_STREAM_ROLLUP_HOUR
+};
+
+static rollup_acc_t acc[IMU_ROLLUP_LEVELS];
+
+/* pedometer total at the previous sample, to turn it into per-window increments */
+static uint32_t last_step_total;
+static bool have_step_total = false;
+
+static K_MUTEX_DEFINE(rollup_lock);
+
+
+/**
+ * @brief adapter from archive records to rollup windows
+ */
+typedef struct rollup_query_ctx {
+    imu_rollup_cb_t cb;
+    void *user;
+} rollup_query_ctx_t;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int16_t rollup_channel(const imu_sample_t *sample, uint8_t ch)
+{
+    return ((const int16_t *)sample)[ch];
+}
+
+
+/*
+ * rollup_open: starts an empty window of `level` containing `ts`
+ */
+static void rollup_open(uint8_t level, uint32_t ts)
+{
+    rollup_acc_t *a = &acc[level];
+
+    a->start_ts = ts - ts % window_ms[level];
+    a->count = 0;
+    a->steps = 0;
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        a->min[ch] = INT16_MAX;
+        a->max[ch] = INT16_MIN;
+        a->sum[ch] = 0;
+    }
+}
+
+
+/*
+ * rollup_close: archives the open window of `level` and merges it one level up
+ *
+ * Caller must hold `rollup_lock`.
+ */
+static int rollup_close(uint8_t level)
+{
+    rollup_acc_t *a = &acc[level];
+    if (a->count == 0) {
+        return 0;
+    }
+
+    imu_rollup_t rollup = {
+        .count = a->count,
+        .steps = a->steps,
+    };
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        rollup.min[ch] = a->min[ch];
+        rollup.max[ch] = a->max[ch];
+        rollup.mean[ch] = (int16_t)(a->sum[ch] / (int64_t)a->count);
+    }
+
+    int rc = archive_append(level_stream[level], a->start_ts, &rollup, sizeof(rollup));
+    if (rc != 0) {
+        LOG_ERR("Rollup write for level %d failed: %d", level, rc);
+    }
+
+    if (level + 1 < IMU_ROLLUP_LEVELS) {
+        rollup_acc_t *up = &acc[level + 1];
+        const uint32_t up_start = a->start_ts - a->start_ts % window_ms[level + 1];
+
+        if (up->count > 0 && up->start_ts != up_start) {
+            rollup_close(level + 1);
+        }
+        if (up->count == 0) {
+            rollup_open(level + 1, a->start_ts);
+        }
+
+        up->count += a->count;
+        up->steps += a->steps;
+        for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+            up->min[ch] = MIN(up->min[ch], a->min[ch]);
+            up->max[ch] = MAX(up->max[ch], a->max[ch]);
+            up->sum[ch] += a->sum[ch];
+        }
+    }
+
+    a->count = 0;
+    return rc;
+}
+
+
+/*
+ * rollup_query_adapter: unpacks one archived window for the caller's callback
+ */
+static int rollup_query_adapter(uint32_t ts, const uint8_t *data, size_t len, void *user)
+{
+    const rollup_query_ctx_t *ctx = user;
+
+    if (len != sizeof(imu_rollup_t)) {
+        return 0;
+    }
+
+    imu_rollup_t rollup;
+    memcpy(&rollup, data, sizeof(rollup));
+    return ctx->cb(ts, &rollup, ctx->user);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL FUNCTIONS ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void imu_rollup_init(void)
+{
+    k_mutex_lock(&rollup_lock, K_FOREVER);
+
+    for (uint8_t level = 0; level < IMU_ROLLUP_LEVELS; level++) {
+        acc[level].count = 0;
+        archive_set_commit_deadline(level_stream[level], deadline_ms[level]);
+    }
+    have_step_total = false;
+
+    k_mutex_unlock(&rollup_lock);
+}
+
+
+/*
+ * imu_rollup_add: adds a sample to the second window, closing windows it has moved past
+ */
+int imu_rollup_add(uint32_t ts, const imu_sample_t *sample, uint32_t step_total)
+{
+    int rc = 0;
+
+    k_mutex_lock(&rollup_lock, K_FOREVER);
+
+    rollup_acc_t *a = &acc[IMU_ROLLUP_SEC];
+
+    /* past the window end, or time went backwards */
+    if (a->count > 0 && (ts < a->start_ts || ts - a->start_ts >= window_ms[IMU_ROLLUP_SEC])) {
+        rc = rollup_close(IMU_ROLLUP_SEC);
+    }
+    if (a->count == 0) {
+        rollup_open(IMU_ROLLUP_SEC, ts);
+    }
+
+    /* the pedometer count restarts from 0 after an IMU reset */
+    uint32_t steps = 0;
+    if (have_step_total) {
+        steps = (step_total >= last_step_total) ? step_total - last_step_total : step_total;
+    }
+    last_step_total = step_total;
+    have_step_total = true;
+
+    a->count++;
+    a->steps += steps;
+    for (uint8_t ch = 0; ch < IMU_CODEC_CHANNELS; ch++) {
+        const int16_t v = rollup_channel(sample, ch);
+        a->min[ch] = MIN(a->min[ch], v);
+        a->max[ch] = MAX(a->max[ch], v);
+        a->sum[ch] += v;
+    }
+
+    k_mutex_unlock(&rollup_lock);
+    return rc;
+}
+
+
+/*
+ * imu_rollup_flush: closes every open window early and writes the rollup streams
+ */
+int imu_rollup_flush(void)
+{
+    int rc = 0;
+
+    k_mutex_lock(&rollup_lock, K_FOREVER);
+    for (uint8_t level = 0; level < IMU_ROLLUP_LEVELS; level++) {
+        int status = rollup_close(level);
+        if (status != 0) {
+            rc = status;
+        }
+    }
+    k_mutex_unlock(&rollup_lock);
+
+    int status = archive_sync();
+    return rc ? rc : status;
+}
+
+
+/*
+ * imu_rollup_query: passes every archived window of one level in a time range to `cb`
+ */
+int imu_rollup_query(imu_rollup_level_t level, uint32_t start_ts, uint32_t end_ts,
+                     imu_rollup_cb_t cb, void *user)
+{
+    if (level >= IMU_ROLLUP_LEVELS) {
+        return -EINVAL;
+    }
+
+    rollup_query_ctx_t ctx = {
+        .cb = cb,
+        .user = user,
+    };
+    return archive_query(level_stream[level], start_ts, end_ts, rollup_query_adapter, &ctx);
+}
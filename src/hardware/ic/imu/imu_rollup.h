@@ -0,0 +1,95 @@
+//*****************************************************************************
+//!
+//! @file imu_rollup.h
+//! @author Anders Bandt
+//! @brief Per-second/minute/hour aggregates of the IMU stream, archived beside the raw data
+//! @version 0.9
+//! @date October 2026
+//!
+//*****************************************************************************
+
+#ifndef SRC_IC_IMU_IMU_ROLLUP_H_
+#define SRC_IC_IMU_IMU_ROLLUP_H_
+
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stddef.h>
+
+/* My header files  */
+#include <imu_codec.h>
+
+
+/**
+ * @brief rollup resolutions, each written to its own archive stream
+ */
+typedef enum {
+    IMU_ROLLUP_SEC,
+    IMU_ROLLUP_MIN,
+    IMU_ROLLUP_HOUR,
+    IMU_ROLLUP_LEVELS
+} imu_rollup_level_t;
+
+/* window lengths in ms, indexed by imu_rollup_level_t */
+#define IMU_ROLLUP_WINDOWS_MS   { 1000, 60 * 1000, 60 * 60 * 1000 }
+
+/* how long a partial segment of each level may wait in RAM (0 = until full or synced) */
+#define IMU_ROLLUP_DEADLINES_MS { 60 * 1000, 0, 0 }
+
+
+/**
+ * @brief one closed window, as stored in the archive (record timestamp = window start)
+ */
+typedef struct imu_rollup {
+    uint32_t count;                       // samples in the window
+    uint32_t steps;                       // pedometer steps counted in the window
+    int16_t min[IMU_CODEC_CHANNELS];
+    int16_t max[IMU_CODEC_CHANNELS];
+    int16_t mean[IMU_CODEC_CHANNELS];
+} __attribute__((packed)) imu_rollup_t;
+
+
+/**
+ * @brief called for every window of a query, oldest first
+ *
+ * @return 0 to continue, anything else stops the query
+ */
+typedef int (*imu_rollup_cb_t)(uint32_t start_ts, const imu_rollup_t *rollup, void *user);
+
+
+/**
+ * @brief resets the open windows and sets the commit deadlines of the rollup streams
+ *
+ * @desc call after archive_init(). Minute and hour windows are only written when their
+ *       segment fills up or on archive_sync(); after a crash the second rollups on flash
+ *       still cover that time.
+ */
+void imu_rollup_init(void);
+
+
+/**
+ * @brief adds one sample to the open window of every level, closing windows it passes
+ *
+ * @param[in]   ts          sample time in ms (same time base as the raw archive)
+ * @param[in]   step_total  running pedometer count; the increase goes to the open windows
+ */
+int imu_rollup_add(uint32_t ts, const imu_sample_t *sample, uint32_t step_total);
+
+
+/**
+ * @brief closes every open window early and writes the rollup streams, e.g. before a
+ *        clean shutdown
+ */
+int imu_rollup_flush(void);
+
+
+/**
+ * @brief calls `cb` for every archived window of `level` starting in [start_ts, end_ts]
+ *
+ * @return number of windows passed to `cb`, or a negative error code
+ */
+int imu_rollup_query(imu_rollup_level_t level, uint32_t start_ts, uint32_t end_ts,
+                     imu_rollup_cb_t cb, void *user);
+
+
+#endif /* SRC_IC_IMU_IMU_ROLLUP_H_ */
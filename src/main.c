@@ -25,6 +25,8 @@
 #include <display.h>
 #include <ui.h>
 #include <imu.h>
+#include <memory/nvs.h>
+#include <memory/archive.h>
 
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
@@ -42,6 +44,9 @@ extern int display_status;
 // BELOW ARE ACTUALLY NOT GLOBAL but probably should be
 bool imu_status;
 
+// set once the flash log is mounted, IMU samples are only archived then
+static bool imu_logging = false;
+
 
 /* Thread stack sizes */
 // TODO: give more thought to these stack sizes (pairs with next TODO down below about stack printing)
@@ -49,24 +54,33 @@ bool imu_status;
 #define UI_REFRESH_STACK_SIZE 1024
 #define DISPLAY_TIMEOUT_STACK_SIZE 512
 #define BUTTON_HANDLER_STACK_SIZE 1024
+// imu_process -> archive -> nvs -> ftl -> mt29f peaks near 2 KB (gcc -fstack-usage, rollup cascade
+// plus a block retire under a checkpoint write), the rest covers the SPI driver, logging and exception frames
+#define IMU_LOG_STACK_SIZE 3072
 
 /* Thread priorities (lower number = higher priority) */
 #define CLOCK_UPDATE_PRIORITY 7
 #define UI_REFRESH_PRIORITY 7
 #define DISPLAY_TIMEOUT_PRIORITY 7
 #define BUTTON_HANDLER_PRIORITY 5  /* Higher priority for user input */
+#define IMU_LOG_PRIORITY 6         /* Below input, above the UI so the sample ring keeps draining */
 
 /* Thread stacks */
 K_THREAD_STACK_DEFINE(clock_update_stack, CLOCK_UPDATE_STACK_SIZE);
 K_THREAD_STACK_DEFINE(ui_refresh_stack, UI_REFRESH_STACK_SIZE);
 K_THREAD_STACK_DEFINE(display_timeout_stack, DISPLAY_TIMEOUT_STACK_SIZE);
 K_THREAD_STACK_DEFINE(button_handler_stack, BUTTON_HANDLER_STACK_SIZE);
+K_THREAD_STACK_DEFINE(imu_log_stack, IMU_LOG_STACK_SIZE);
 
 /* Thread control blocks */
 struct k_thread clock_update_thread;
 struct k_thread ui_refresh_thread;
 struct k_thread display_timeout_thread;
 struct k_thread button_handler_thread;
+struct k_thread imu_log_thread;
+
+/* Signals the IMU logging thread that new samples are in the ring buffer */
+K_SEM_DEFINE(imu_log_sem, 0, 1);
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //! -----------------------------------------------------------------------------------------------------------------------//
@@ -208,6 +222,9 @@ void button_handler_thread_entry(void *p1, void *p2, void *p3) {
             LOG_INF("IMU INT1 triggered");
             led_set(2, 1);
             get_fifo_data();
+            if (IMU_LOG_TO_FLASH && imu_logging) {
+                k_sem_give(&imu_log_sem);
+            }
         }
 
         /* IMU INT2 */
@@ -217,10 +234,25 @@ void button_handler_thread_entry(void *p1, void *p2, void *p3) {
             LOG_INF("IMU INT2 triggered");
             led_set(3, 1);
             get_fifo_data();
+            if (IMU_LOG_TO_FLASH && imu_logging) {
+                k_sem_give(&imu_log_sem);
+            }
         }
     }
 }
 
+/**
+ * @brief IMU logging thread
+ *
+ * Woken by the button handler after each FIFO read, encodes and archives the buffered samples
+ */
+void imu_log_thread_entry(void *p1, void *p2, void *p3) {
+    while (1) {
+        k_sem_take(&imu_log_sem, K_FOREVER);
+        imu_process();
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //! -----------------------------------------------------------------------------------------------------------------------//
 //! MAIN FUNCTION ---------------------------------------------------------------------------------------------------------//
@@ -251,7 +283,18 @@ int main(void)
     /*
     NVS CONFIG BLOCK
     */
-	// nvs_init();
+    if (IMU_LOG_TO_FLASH) {
+        int rc = nvs_init();
+        if (rc != 0) {
+            LOG_ERR("NVS init failed with code [%d], IMU logging disabled", rc);
+        } else {
+            rc = archive_init();
+            if (rc != 0) {
+                LOG_ERR("Archive init failed with code [%d], IMU logging disabled", rc);
+            }
+        }
+        imu_logging = (rc == 0);
+    }
     // static uint8_t data[2176];
     // data[0] = 8;
     // data[1] = 9;
@@ -322,6 +365,16 @@ int main(void)
                     BUTTON_HANDLER_PRIORITY, 0, K_NO_WAIT);
     k_thread_name_set(&button_handler_thread, "button_handler");
 
+    /* Create IMU logging thread */
+    if (IMU_LOG_TO_FLASH && imu_logging) {
+        k_thread_create(&imu_log_thread, imu_log_stack,
+                        K_THREAD_STACK_SIZEOF(imu_log_stack),
+                        imu_log_thread_entry,
+                        NULL, NULL, NULL,
+                        IMU_LOG_PRIORITY, 0, K_NO_WAIT);
+        k_thread_name_set(&imu_log_thread, "imu_log");
+    }
+
 
     /* Main thread can now sleep - all work is done by worker threads */
     LOG_INF("Starting WWD program!");
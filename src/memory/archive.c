@@ -0,0 +1,790 @@
+//*****************************************************************************
+//!
+//! @file archive.c
+//! @author Anders Bandt
+//! @brief Timestamp-indexed sample archive on top of the NVS log
+//! @version 0.9
+//! @date October 2026
+//!
+//! Every segment is a typed NVS page: an archive_seg_hdr_t followed by records.
+//! The log is written in time order, so the `seal_ts` of the segments grows
+//! monotonically through the log and a segment with seal_ts < start cannot hold a
+//! record at or after `start`. A range query therefore:
+//!     1. binary searches the blocks (oldest to newest) on the seal_ts of their first
+//!        segment, using a small RAM cache of block keys filled lazily and on every write,
+//!     2. binary searches the segment headers inside that block,
+//!     3. reads pages forward until a segment of the stream starts after `end`.
+//!
+//! That only holds for streams sealed soon after their records. Streams without a
+//! commit deadline (the minute and hour rollups) may sit in RAM for days, so every
+//! segment also records the newest earlier segment of each stream; their queries
+//! walk that chain back from the newest segment and touch no other pages.
+//!
+//*****************************************************************************
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+/* My header files  */
+#include <archive.h>
+#include <nvs.h>
+
+
+LOG_MODULE_REGISTER(archive, LOG_LEVEL_INF);
+
+
+/* index keys that are not timestamps */
+#define KEY_UNKNOWN     0xFFFFFFFF  /* block not looked at yet */
+#define KEY_NONE        0xFFFFFFFE  /* block holds no archive segment */
+
+#define NO_BLOCK        UINT32_MAX
+
+/* chain segments collected per pass before they are emitted oldest first */
+#define CHAIN_DEPTH     32
+
+/* block keys kept in RAM; a block search touches about log2(blocks) of them */
+#define INDEX_SLOT_BITS 6
+#define INDEX_SLOTS     BIT(INDEX_SLOT_BITS)
+#define INDEX_EMPTY     UINT16_MAX
+
+/* seal_ts of the first archive segment of recently used blocks, hashed by block */
+static uint16_t index_block[INDEX_SLOTS];
+static uint32_t index_key[INDEX_SLOTS];
+
+/* block of the last segment written by the archive, to spot blocks others started since */
+static uint32_t last_block = NO_BLOCK;
+
+/* log page of the newest written segment of every stream, heads of the segment chains */
+static uint32_t stream_head[ARCHIVE_MAX_STREAMS];
+
+/* newest timestamp appended on any stream; becomes the seal_ts of the next segment */
+static uint32_t clock_ts = 0;
+
+/* open segments, starting with their archive_seg_hdr_t; streams sharing a buffer take turns */
+static const uint8_t seg_buffer[ARCHIVE_MAX_STREAMS] = ARCHIVE_STREAM_BUFFERS;
+static uint8_t open_seg[ARCHIVE_SEG_BUFFERS][NVS_PAGE_PAYLOAD];
+static size_t open_len[ARCHIVE_MAX_STREAMS];
+
+/* query scratch page, and the chain pages of one pass of a chain query */
+static uint8_t query_page[NVS_PAGE_PAYLOAD];
+static size_t query_len;
+static uint32_t chain_pages[CHAIN_DEPTH];
+
+/* per-stream commit deadline, and the uptime at which each open segment is due (0 = none) */
+static uint32_t stream_deadline_ms[ARCHIVE_MAX_STREAMS];
+static int64_t due_ms[ARCHIVE_MAX_STREAMS];
+
+static struct k_work_delayable commit_work;
+
+/* `archive_lock` guards the open segments and the index, `query_lock` the scratch page */
+static K_MUTEX_DEFINE(archive_lock);
+static K_MUTEX_DEFINE(query_lock);
+
+static uint32_t num_blocks;
+static uint32_t pages_per_block;
+static off_t bytes_per_block;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static off_t archive_page_addr(uint32_t block, uint32_t page)
+{
+    return block * bytes_per_block + (off_t)page * NVS_PAGE_SIZE;
+}
+
+
+static uint32_t archive_index_slot(uint32_t block)
+{
+    /* multiplicative hash: the midpoints of a binary search are multiples of large powers of two */
+    return (block * 2654435761u) >> (32 - INDEX_SLOT_BITS);
+}
+
+
+/*
+ * archive_index_get: cached key of a block, KEY_UNKNOWN if it is not in the cache
+ *
+ * Caller must hold `archive_lock`.
+ */
+static uint32_t archive_index_get(uint32_t block)
+{
+    const uint32_t slot = archive_index_slot(block);
+
+    return (index_block[slot] == block) ? index_key[slot] : KEY_UNKNOWN;
+}
+
+
+/*
+ * archive_index_set: caches the key of a block, KEY_UNKNOWN drops it
+ *
+ * Caller must hold `archive_lock`.
+ */
+static void archive_index_set(uint32_t block, uint32_t key)
+{
+    const uint32_t slot = archive_index_slot(block);
+
+    if (key != KEY_UNKNOWN) {
+        index_block[slot] = block;
+        index_key[slot] = key;
+    } else if (index_block[slot] == block) {
+        index_block[slot] = INDEX_EMPTY;
+    }
+}
+
+
+/*
+ * archive_load: reads one log page into `query_page` (payload length in `query_len`)
+ *
+ * Returns 0 for an archive segment, -ENOENT for an erased page, -ENODATA for any other
+ * page and the read error otherwise. Caller must hold `query_lock`.
+ */
+static int archive_load(off_t addr, const archive_seg_hdr_t **seg)
+{
+    uint16_t type;
+
+    int rc = nvs_read_page(addr, query_page, &query_len, NULL, &type);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (type != NVS_PAGE_TYPE_ARCHIVE || query_len < sizeof(archive_seg_hdr_t)) {
+        return -ENODATA;
+    }
+
+    *seg = (const archive_seg_hdr_t *)query_page;
+    return 0;
+}
+
+
+/*
+ * archive_block_key: index key of a block, read from flash unless it is cached
+ *
+ * Caller must hold `query_lock`.
+ */
+static uint32_t archive_block_key(uint32_t block)
+{
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    uint32_t key = archive_index_get(block);
+    k_mutex_unlock(&archive_lock);
+
+    if (key != KEY_UNKNOWN) {
+        return key;
+    }
+
+    key = KEY_NONE;
+    for (uint32_t page = 0; page < pages_per_block; page++) {
+        const archive_seg_hdr_t *seg;
+        int rc = archive_load(archive_page_addr(block, page), &seg);
+
+        /* pages are programmed in order: the rest of the block is erased */
+        if (rc == -ENOENT) {
+            break;
+        }
+        if (rc == 0) {
+            key = seg->seal_ts;
+            break;
+        }
+    }
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    if (archive_index_get(block) == KEY_UNKNOWN) {
+        archive_index_set(block, key);
+    }
+    k_mutex_unlock(&archive_lock);
+
+    return key;
+}
+
+
+/*
+ * archive_log_extent: oldest block of the log and the number of blocks holding data
+ *
+ * Caller must hold `query_lock`.
+ */
+static uint32_t archive_log_extent(uint32_t *oldest)
+{
+    const off_t head = nvs_get_addr_offset();
+    const uint32_t head_block = head / bytes_per_block;
+
+    /* the head points at the next free page: at a block boundary the previous block is the newest */
+    const uint32_t newest = (head % bytes_per_block == 0) ? (head_block + num_blocks - 1) % num_blocks
+                                                         : head_block;
+
+    const archive_seg_hdr_t *seg;
+    if (archive_load(archive_page_addr(newest, 0), &seg) == -ENOENT) {
+        return 0;
+    }
+
+    /* the block after the newest still holds data once the log has wrapped */
+    const uint32_t next = (newest + 1) % num_blocks;
+    if (next != 0 && archive_load(archive_page_addr(next, 0), &seg) != -ENOENT) {
+        *oldest = next;
+        return num_blocks;
+    }
+
+    *oldest = 0;
+    return newest + 1;
+}
+
+
+/*
+ * archive_ordered_key: key of the i-th block in log order
+ *
+ * A block without archive segments takes the key of the nearest block before it that
+ * has one, which keeps the keys sorted. With no such block it sorts first.
+ */
+static uint32_t archive_ordered_key(uint32_t oldest, uint32_t i)
+{
+    for (;;) {
+        uint32_t key = archive_block_key((oldest + i) % num_blocks);
+        if (key != KEY_NONE) {
+            return key;
+        }
+        if (i == 0) {
+            return 0;
+        }
+        i--;
+    }
+}
+
+
+/*
+ * archive_page_key: seal_ts of the segment in a page, same rules as the block keys
+ */
+static uint32_t archive_page_key(uint32_t block, uint32_t page)
+{
+    for (;;) {
+        const archive_seg_hdr_t *seg;
+        int rc = archive_load(archive_page_addr(block, page), &seg);
+
+        if (rc == -ENOENT) {
+            return KEY_UNKNOWN;
+        }
+        if (rc == 0) {
+            return seg->seal_ts;
+        }
+        if (page == 0) {
+            return 0;
+        }
+        page--;
+    }
+}
+
+
+/*
+ * archive_emit: passes the records of one segment inside [start_ts, end_ts] to `cb`
+ *
+ * Returns the number of records passed, and sets `stop` if the callback asked to stop.
+ */
+static int archive_emit(const uint8_t *segment, size_t len, uint32_t start_ts, uint32_t end_ts,
+                        archive_cb_t cb, void *user, bool *stop)
+{
+    const archive_seg_hdr_t *seg = (const archive_seg_hdr_t *)segment;
+    size_t pos = sizeof(archive_seg_hdr_t);
+    int count = 0;
+
+    if (seg->last_ts < start_ts || seg->first_ts > end_ts) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < seg->count && pos + sizeof(archive_rec_hdr_t) <= len; i++) {
+        archive_rec_hdr_t rec;
+        memcpy(&rec, &segment[pos], sizeof(rec));
+        pos += sizeof(rec);
+
+        if (pos + rec.len > len || rec.ts > end_ts) {
+            break;
+        }
+
+        if (rec.ts >= start_ts) {
+            count++;
+            if (cb(rec.ts, &segment[pos], rec.len, user) != 0) {
+                *stop = true;
+                break;
+            }
+        }
+        pos += rec.len;
+    }
+
+    return count;
+}
+
+
+/*
+ * archive_chain_load: loads the segment in log page `page` if it can precede a segment
+ *                     of `stream` starting at `first_ts` and sealed at `seal_ts`
+ *
+ * Pages the log has recycled since fail the check. Caller must hold `query_lock`.
+ */
+static bool archive_chain_load(uint32_t page, uint8_t stream, uint32_t first_ts, uint32_t seal_ts,
+                               const archive_seg_hdr_t **seg)
+{
+    if (page >= num_blocks * pages_per_block ||
+        archive_load((off_t)page * NVS_PAGE_SIZE, seg) != 0) {
+        return false;
+    }
+
+    return (*seg)->stream == stream && (*seg)->last_ts <= first_ts && (*seg)->seal_ts <= seal_ts;
+}
+
+
+/*
+ * archive_query_chain: emits the written segments of a stream by walking its chain
+ *
+ * The chain runs newest to oldest, so every pass walks it back to `start_ts`, keeps the
+ * oldest CHAIN_DEPTH segments not emitted yet and emits those oldest first. Ranges of up
+ * to CHAIN_DEPTH segments take a single pass. Caller must hold `query_lock`.
+ */
+static int archive_query_chain(uint8_t stream, uint32_t start_ts, uint32_t end_ts,
+                               archive_cb_t cb, void *user, bool *stop)
+{
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    const uint32_t newest = stream_head[stream];
+    k_mutex_unlock(&archive_lock);
+
+    uint32_t emitted = ARCHIVE_NO_SEGMENT;
+    int count = 0;
+
+    while (!*stop) {
+        const archive_seg_hdr_t *seg;
+        uint32_t page = newest;
+        uint32_t first_ts = UINT32_MAX;
+        uint32_t seal_ts = UINT32_MAX;
+        uint32_t total = 0;
+
+        while (page != emitted && archive_chain_load(page, stream, first_ts, seal_ts, &seg) &&
+               seg->last_ts >= start_ts) {
+            if (seg->first_ts <= end_ts) {
+                chain_pages[total % CHAIN_DEPTH] = page;
+                total++;
+            }
+            first_ts = seg->first_ts;
+            seal_ts = seg->seal_ts;
+            page = seg->heads[stream];
+        }
+
+        const uint32_t n = MIN(total, CHAIN_DEPTH);
+        for (uint32_t i = 0; i < n && !*stop; i++) {
+            const uint32_t p = chain_pages[(total - 1 - i) % CHAIN_DEPTH];
+            if (archive_load((off_t)p * NVS_PAGE_SIZE, &seg) == 0) {
+                count += archive_emit(query_page, query_len, start_ts, end_ts, cb, user, stop);
+            }
+        }
+
+        if (total <= CHAIN_DEPTH) {
+            break;
+        }
+        emitted = chain_pages[(total - CHAIN_DEPTH) % CHAIN_DEPTH];
+    }
+
+    return count;
+}
+
+
+/*
+ * archive_seal: writes the open segment of a stream and updates the index
+ *
+ * Caller must hold `archive_lock`.
+ */
+static int archive_seal(uint8_t stream)
+{
+    if (open_len[stream] == 0) {
+        return 0;
+    }
+
+    archive_seg_hdr_t *seg = (archive_seg_hdr_t *)open_seg[seg_buffer[stream]];
+    seg->seal_ts = MAX(clock_ts, seg->last_ts);
+    memcpy(seg->heads, stream_head, sizeof(seg->heads));
+
+    off_t addr;
+    int rc = nvs_write_page(seg, open_len[stream], NVS_PAGE_TYPE_ARCHIVE, &addr);
+    if (rc != 0) {
+        LOG_ERR("Archive segment write failed: %d", rc);
+        return rc;
+    }
+    open_len[stream] = 0;
+    due_ms[stream] = 0;
+    stream_head[stream] = addr / NVS_PAGE_SIZE;
+
+    const uint32_t block = addr / bytes_per_block;
+    const uint32_t page = (addr % bytes_per_block) / NVS_PAGE_SIZE;
+
+    if (block != last_block) {
+        /* blocks the log started since our last segment were written by someone else */
+        if (last_block != NO_BLOCK) {
+            for (uint32_t b = (last_block + 1) % num_blocks; b != block; b = (b + 1) % num_blocks) {
+                archive_index_set(b, KEY_UNKNOWN);
+            }
+        }
+        archive_index_set(block, (page == 0) ? seg->seal_ts : KEY_UNKNOWN);
+        last_block = block;
+    } else if (archive_index_get(block) == KEY_NONE) {
+        archive_index_set(block, seg->seal_ts);
+    }
+
+    return 0;
+}
+
+
+/*
+ * archive_schedule: arms the deadline work for the open segment that is due first
+ *
+ * Caller must hold `archive_lock`.
+ */
+static void archive_schedule(void)
+{
+    int64_t next = 0;
+    for (uint8_t stream = 0; stream < ARCHIVE_MAX_STREAMS; stream++) {
+        if (due_ms[stream] != 0 && (next == 0 || due_ms[stream] < next)) {
+            next = due_ms[stream];
+        }
+    }
+
+    if (next == 0) {
+        k_work_cancel_delayable(&commit_work);
+        return;
+    }
+
+    k_work_reschedule(&commit_work, K_MSEC(MAX(next - k_uptime_get(), 0)));
+}
+
+
+/*
+ * archive_commit_deadline_handler: writes partially filled segments once their deadline passes
+ */
+static void archive_commit_deadline_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+
+    const int64_t now = k_uptime_get();
+    for (uint8_t stream = 0; stream < ARCHIVE_MAX_STREAMS; stream++) {
+        if (due_ms[stream] != 0 && due_ms[stream] <= now) {
+            int rc = archive_seal(stream);
+            if (rc != 0) {
+                LOG_ERR("Archive deadline commit failed: %d", rc);
+                due_ms[stream] = 0;
+            }
+        }
+    }
+    archive_schedule();
+
+    k_mutex_unlock(&archive_lock);
+}
+
+
+/*
+ * archive_recover: takes the archive clock and the chain heads from the newest segment
+ */
+static void archive_recover(void)
+{
+    uint32_t oldest;
+    const uint32_t blocks = archive_log_extent(&oldest);
+    const uint32_t pages = blocks * pages_per_block;
+
+    off_t addr = nvs_get_addr_offset();
+    for (uint32_t i = 0; i < MIN(pages, ARCHIVE_RECOVER_PAGES); i++) {
+        addr = (addr == 0) ? (off_t)num_blocks * bytes_per_block : addr;
+        addr -= NVS_PAGE_SIZE;
+
+        const archive_seg_hdr_t *seg;
+        if (archive_load(addr, &seg) == 0) {
+            clock_ts = seg->seal_ts;
+            memcpy(stream_head, seg->heads, sizeof(stream_head));
+            stream_head[seg->stream] = addr / NVS_PAGE_SIZE;
+            return;
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL FUNCTIONS ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int archive_init(void)
+{
+    bytes_per_block = nvs_get_block_size();
+    num_blocks = nvs_get_region_size() / bytes_per_block;
+    pages_per_block = bytes_per_block / NVS_PAGE_SIZE;
+
+    if (num_blocks >= INDEX_EMPTY) {
+        LOG_ERR("Archive index too small for %d blocks", num_blocks);
+        return -ENOMEM;
+    }
+
+    k_work_init_delayable(&commit_work, archive_commit_deadline_handler);
+
+    k_mutex_lock(&query_lock, K_FOREVER);
+    k_mutex_lock(&archive_lock, K_FOREVER);
+
+    memset(index_block, 0xFF, sizeof(index_block));
+    memset(open_len, 0, sizeof(open_len));
+    memset(due_ms, 0, sizeof(due_ms));
+    for (uint8_t stream = 0; stream < ARCHIVE_MAX_STREAMS; stream++) {
+        stream_deadline_ms[stream] = ARCHIVE_COMMIT_DEADLINE_MS;
+    }
+    memset(stream_head, 0xFF, sizeof(stream_head));
+    last_block = NO_BLOCK;
+    clock_ts = 0;
+    archive_recover();
+
+    k_mutex_unlock(&archive_lock);
+    k_mutex_unlock(&query_lock);
+
+    LOG_INF("Archive up, clock at %u", clock_ts);
+    return 0;
+}
+
+
+/*
+ * archive_append: adds a record to the open segment of a stream
+ */
+int archive_append(uint8_t stream, uint32_t ts, const void *data, size_t len)
+{
+    if (stream >= ARCHIVE_MAX_STREAMS || len > ARCHIVE_MAX_RECORD || ts >= ARCHIVE_TS_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+
+    uint8_t *open = open_seg[seg_buffer[stream]];
+    archive_seg_hdr_t *seg = (archive_seg_hdr_t *)open;
+    int rc = 0;
+
+    if (open_len[stream] > 0 && ts < seg->last_ts) {
+        rc = -EINVAL;
+        goto out;
+    }
+
+    clock_ts = MAX(clock_ts, ts);
+
+    if (open_len[stream] + sizeof(archive_rec_hdr_t) + len > NVS_PAGE_PAYLOAD) {
+        rc = archive_seal(stream);
+        if (rc != 0) {
+            goto out;
+        }
+    }
+
+    /* first record opens a new segment and starts the commit deadline */
+    if (open_len[stream] == 0) {
+        /* the segment of another stream still holds the shared buffer */
+        for (uint8_t other = 0; other < ARCHIVE_MAX_STREAMS; other++) {
+            if (other != stream && seg_buffer[other] == seg_buffer[stream] && open_len[other] > 0) {
+                rc = archive_seal(other);
+                if (rc != 0) {
+                    goto out;
+                }
+                archive_schedule();
+            }
+        }
+
+        memset(seg, 0xFF, sizeof(*seg));
+        seg->first_ts = ts;
+        seg->count = 0;
+        seg->stream = stream;
+        open_len[stream] = sizeof(*seg);
+
+        if (stream_deadline_ms[stream] > 0) {
+            due_ms[stream] = k_uptime_get() + stream_deadline_ms[stream];
+            archive_schedule();
+        }
+    }
+
+    const archive_rec_hdr_t rec = {
+        .ts = ts,
+        .len = len,
+    };
+    memcpy(&open[open_len[stream]], &rec, sizeof(rec));
+    memcpy(&open[open_len[stream] + sizeof(rec)], data, len);
+    open_len[stream] += sizeof(rec) + len;
+    seg->last_ts = ts;
+    seg->count++;
+
+out:
+    k_mutex_unlock(&archive_lock);
+    return rc;
+}
+
+
+/*
+ * archive_sync: writes every partially filled segment
+ */
+int archive_sync(void)
+{
+    int rc = 0;
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    for (uint8_t stream = 0; stream < ARCHIVE_MAX_STREAMS; stream++) {
+        int status = archive_seal(stream);
+        if (status != 0) {
+            rc = status;
+        }
+    }
+    archive_schedule();
+    k_mutex_unlock(&archive_lock);
+
+    return rc;
+}
+
+
+/*
+ * archive_get_clock: newest timestamp recovered at init or appended since
+ */
+uint32_t archive_get_clock(void)
+{
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    const uint32_t ts = clock_ts;
+    k_mutex_unlock(&archive_lock);
+
+    return ts;
+}
+
+
+/*
+ * archive_set_commit_deadline: sets how long a stream's partial segment may sit in RAM
+ */
+void archive_set_commit_deadline(uint8_t stream, uint32_t deadline_ms)
+{
+    if (stream >= ARCHIVE_MAX_STREAMS) {
+        return;
+    }
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    stream_deadline_ms[stream] = deadline_ms;
+    if (deadline_ms == 0) {
+        due_ms[stream] = 0;
+    }
+    archive_schedule();
+    k_mutex_unlock(&archive_lock);
+}
+
+
+/*
+ * archive_query: passes every record of a stream within [start_ts, end_ts] to `cb`
+ */
+int archive_query(uint8_t stream, uint32_t start_ts, uint32_t end_ts, archive_cb_t cb, void *user)
+{
+    if (stream >= ARCHIVE_MAX_STREAMS || start_ts > end_ts) {
+        return -EINVAL;
+    }
+
+    int count = 0;
+    bool stop = false;
+
+    k_mutex_lock(&query_lock, K_FOREVER);
+
+    k_mutex_lock(&archive_lock, K_FOREVER);
+    const bool chained = (stream_deadline_ms[stream] == 0);
+    k_mutex_unlock(&archive_lock);
+
+    uint32_t oldest;
+    const uint32_t blocks = chained ? 0 : archive_log_extent(&oldest);
+
+    if (chained) {
+        count = archive_query_chain(stream, start_ts, end_ts, cb, user, &stop);
+    } else if (blocks > 0) {
+        /* level 1: last block whose first segment was sealed before `start_ts` */
+        uint32_t lo = 0;
+        uint32_t hi = blocks - 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            if (archive_ordered_key(oldest, mid) < start_ts) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        /* level 2: first segment of that block sealed at or after `start_ts` */
+        const uint32_t first_block = (oldest + lo) % num_blocks;
+        uint32_t page_lo = 0;
+        uint32_t page_hi = pages_per_block;
+        while (page_lo < page_hi) {
+            uint32_t mid = page_lo + (page_hi - page_lo) / 2;
+            if (archive_page_key(first_block, mid) < start_ts) {
+                page_lo = mid + 1;
+            } else {
+                page_hi = mid;
+            }
+        }
+
+        /* read forward until a segment of the stream starts after `end_ts` */
+        for (uint32_t i = lo; i < blocks && !stop; i++) {
+            const uint32_t block = (oldest + i) % num_blocks;
+
+            for (uint32_t page = (i == lo) ? page_lo : 0; page < pages_per_block && !stop; page++) {
+                const archive_seg_hdr_t *seg;
+                int rc = archive_load(archive_page_addr(block, page), &seg);
+
+                if (rc == -ENOENT) {
+                    break;
+                }
+                if (rc == -EBADMSG || rc == -EIO) {
+                    LOG_WRN("Skipping unreadable page at [%d]: %d", (int)archive_page_addr(block, page), rc);
+                    continue;
+                }
+                if (rc != 0 || seg->stream != stream) {
+                    continue;
+                }
+                if (seg->first_ts > end_ts) {
+                    stop = true;
+                    break;
+                }
+
+                count += archive_emit(query_page, query_len, start_ts, end_ts, cb, user, &stop);
+            }
+        }
+    }
+
+    /* records that are still waiting in RAM are the newest of the stream */
+    if (!stop) {
+        k_mutex_lock(&archive_lock, K_FOREVER);
+        const size_t len = open_len[stream];
+        memcpy(query_page, open_seg[seg_buffer[stream]], len);
+        k_mutex_unlock(&archive_lock);
+
+        if (len > 0) {
+            count += archive_emit(query_page, len, start_ts, end_ts, cb, user, &stop);
+        }
+    }
+
+    k_mutex_unlock(&query_lock);
+    return count;
+}
+
+
+/*
+ * archive_format: erases the log and starts over with an empty index
+ */
+void archive_format(void)
+{
+    k_work_cancel_delayable(&commit_work);
+
+    k_mutex_lock(&query_lock, K_FOREVER);
+    k_mutex_lock(&archive_lock, K_FOREVER);
+
+    nvs_erase_region();
+
+    memset(index_block, 0xFF, sizeof(index_block));
+    memset(open_len, 0, sizeof(open_len));
+    memset(due_ms, 0, sizeof(due_ms));
+    memset(stream_head, 0xFF, sizeof(stream_head));
+    last_block = NO_BLOCK;
+    clock_ts = 0;
+
+    k_mutex_unlock(&archive_lock);
+    k_mutex_unlock(&query_lock);
+}
@@ -0,0 +1,161 @@
+//*****************************************************************************
+//!
+//! @file archive.h
+//! @author Anders Bandt
+//! @brief Timestamp-indexed sample archive on top of the NVS log
+//! @version 0.9
+//! @date October 2026
+//!
+//*****************************************************************************
+
+#ifndef SRC_MEMORY_ARCHIVE_H_
+#define SRC_MEMORY_ARCHIVE_H_
+
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* My header files  */
+#include <nvs.h>
+
+
+/*
+ * Records are grouped per stream into segments of one NVS page. A query binary
+ * searches the blocks on the key of their first segment (a 384 byte cache of recently
+ * used keys, the rest is read from flash), then the segment headers of that block, and
+ * reads only the pages from there on. Streams without a commit deadline are instead
+ * followed along their segment chain.
+ */
+#define ARCHIVE_MAX_STREAMS   4
+
+/* stream of raw sensor samples */
+#define ARCHIVE_STREAM_RAW    0
+
+/* aggregate streams, one per resolution (see imu_rollup.h) */
+#define ARCHIVE_STREAM_ROLLUP_SEC   1
+#define ARCHIVE_STREAM_ROLLUP_MIN   2
+#define ARCHIVE_STREAM_ROLLUP_HOUR  3
+
+/*
+ * open segment buffer (one page payload of RAM each) of every stream. Streams sharing a
+ * buffer take turns: a record of one seals the open segment of the other. The minute
+ * and hour rollups share one, at the cost of two partly filled pages per hour.
+ */
+#define ARCHIVE_SEG_BUFFERS     3
+#define ARCHIVE_STREAM_BUFFERS  { 0, 1, 2, 2 }
+
+/* default time a partially filled segment may wait in RAM before it is written */
+#define ARCHIVE_COMMIT_DEADLINE_MS  NVS_COMMIT_DEADLINE_MS
+
+/* timestamps at or above this value are reserved for the index */
+#define ARCHIVE_TS_MAX        0xFFFFFFF0
+
+/* newest log pages searched at init for the last archive segment */
+#define ARCHIVE_RECOVER_PAGES 128
+
+/* end of a segment chain */
+#define ARCHIVE_NO_SEGMENT    0xFFFFFFFF
+
+
+/**
+ * @brief header at the start of every archive segment (the NVS page payload)
+ */
+typedef struct archive_seg_hdr {
+    uint32_t first_ts;  // timestamp of the first record
+    uint32_t last_ts;   // timestamp of the last record
+    uint32_t seal_ts;   // newest timestamp seen on any stream when the segment was written
+    uint16_t count;     // records in the segment
+    uint8_t stream;
+    uint8_t reserved;
+    uint32_t heads[ARCHIVE_MAX_STREAMS];  // log page of the newest earlier segment of every stream
+} __attribute__((packed)) archive_seg_hdr_t;
+
+
+/**
+ * @brief header in front of every record inside a segment
+ */
+typedef struct archive_rec_hdr {
+    uint32_t ts;
+    uint16_t len;
+} __attribute__((packed)) archive_rec_hdr_t;
+
+/* largest record that fits a segment */
+#define ARCHIVE_MAX_RECORD  (NVS_PAGE_PAYLOAD - sizeof(archive_seg_hdr_t) - sizeof(archive_rec_hdr_t))
+
+
+/**
+ * @brief called for every record of a query, in timestamp order
+ *
+ * @return 0 to continue, anything else stops the query
+ */
+typedef int (*archive_cb_t)(uint32_t ts, const uint8_t *data, size_t len, void *user);
+
+
+/**
+ * @brief resets the index and recovers the archive clock and segment chains from the newest segment
+ *
+ * @desc call after nvs_init()
+ */
+int archive_init(void);
+
+
+/**
+ * @brief adds a record to the open segment of a stream
+ *
+ * @desc timestamps are in the caller's time base and must not go backwards within a
+ *       stream. The segment is written once full, on archive_sync() or when the
+ *       commit deadline expires.
+ *
+ * @return -EINVAL for an oversized record or a timestamp older than the previous one
+ */
+int archive_append(uint8_t stream, uint32_t ts, const void *data, size_t len);
+
+
+/**
+ * @brief writes every partially filled segment
+ */
+int archive_sync(void);
+
+
+/**
+ * @brief returns the newest timestamp recovered by archive_init() or appended since
+ *
+ * @desc writers whose time base restarts at boot (e.g. uptime) should offset it by the
+ *       clock read once after archive_init(), so the log stays in time order across
+ *       reboots.
+ */
+uint32_t archive_get_clock(void);
+
+
+/**
+ * @brief sets how long a partially filled segment of `stream` may wait in RAM
+ *
+ * @desc slow streams should use a long deadline (or 0 = only when full or on
+ *       archive_sync()), otherwise every deadline costs a nearly empty page.
+ *       Segments of a stream without deadline can be sealed long after their records,
+ *       so its queries walk the stream's own segments back from the newest one
+ *       instead of searching the log by time.
+ */
+void archive_set_commit_deadline(uint8_t stream, uint32_t deadline_ms);
+
+
+/**
+ * @brief calls `cb` for every record of `stream` with start_ts <= ts <= end_ts
+ *
+ * @desc records still buffered in RAM are included. The callback must not append to
+ *       the archive.
+ *
+ * @return number of records passed to `cb`, or a negative error code
+ */
+int archive_query(uint8_t stream, uint32_t start_ts, uint32_t end_ts, archive_cb_t cb, void *user);
+
+
+/**
+ * @brief erases the NVS region and drops the index
+ */
+void archive_format(void);
+
+
+#endif /* SRC_MEMORY_ARCHIVE_H_ */
@@ -0,0 +1,1431 @@
+//*****************************************************************************
+//!
+//! @file ftl.c
+//! @author Anders Bandt
+//! @brief Block mapped flash translation layer with dynamic and static wear leveling
+//! @version 0.9
+//! @date October 2026
+//!
+//! The map can always be rebuilt from the OOB metadata of every block, but that scan
+//! reads the spare area of the whole chip. Instead the FTL writes checkpoints of its
+//! RAM state to two alternating slot blocks. Every checkpoint also names an erase
+//! pool of free blocks, and until the next checkpoint blocks are only allocated from
+//! that pool, so a mount reads one checkpoint plus the OOB of the pool blocks and
+//! replays whatever was allocated since.
+//!
+//*****************************************************************************
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+
+/* My header files  */
+#include <ftl.h>
+#include <mt29f_nand.h>
+
+
+LOG_MODULE_REGISTER(ftl, LOG_LEVEL_INF);
+
+
+#define FTL_OOB_MAGIC   0x4C544657  /* "WFTL" */
+#define FTL_CKPT_MAGIC  0x504B4357  /* "WCKP" */
+#define FTL_MOVE_MAGIC  0x564D4657  /* "WFMV" */
+#define FTL_UNMAPPED    0xFFFF
+#define FTL_NO_HEAD     0xFFFFFFFF  /* checkpoint taken before the append head was set */
+
+
+/*
+ * Metadata stored in the spare area of page 0 of every mapped physical block
+ */
+typedef struct ftl_oob {
+    uint32_t magic;
+    uint32_t erase_count;
+    uint32_t seq;           // allocation sequence, newest copy wins after a power cut
+    uint16_t vblock;
+    uint16_t moved_pages;   // pages copied by ftl_move_block, 0 for a block written by the append stream
+    uint16_t crc;
+} __packed ftl_oob_t;
+
+BUILD_ASSERT(sizeof(ftl_oob_t) <= OOB_USER_BYTES, "FTL OOB metadata does not fit the spare area");
+
+
+/*
+ * Commit record in the spare area of the last page copied by a block move
+ *
+ * Pages have to be programmed in order, so page 0 and its metadata go out first. A move
+ * only counts once this record matches the seq in page 0, a power cut before that leaves
+ * the source block mapped.
+ */
+typedef struct ftl_move_rec {
+    uint32_t magic;
+    uint32_t seq;
+} __packed ftl_move_rec_t;
+
+BUILD_ASSERT(sizeof(ftl_move_rec_t) <= OOB_USER_BYTES, "FTL move record does not fit the spare area");
+
+
+/*
+ * Header of a checkpoint, followed by the map, the erase count deltas and the stale
+ * bitmap. The image spans several pages of a slot block (main area only).
+ */
+typedef struct ftl_ckpt_hdr {
+    uint32_t magic;
+    uint32_t seq;           // checkpoint sequence, newest valid copy wins
+    uint32_t alloc_seq;     // OOB seq of the first allocation after the checkpoint
+    uint32_t ec_base;
+    uint32_t append_head;
+    uint16_t num_phys;
+    uint16_t num_virt;
+    uint16_t pool[FTL_CKPT_POOL];
+    uint32_t crc;           // over the header up to here and the rest of the image
+} __packed ftl_ckpt_hdr_t;
+
+
+/* geometry */
+static uint32_t bytes_per_page;
+static uint32_t bytes_per_block;
+static uint32_t pages_per_block;
+static uint32_t num_phys = 0;
+static uint32_t num_virt = 0;
+static uint8_t num_dies;
+
+/* virtual -> physical block map */
+static uint16_t map[FTL_MAX_BLOCKS];
+
+/* erase counters, stored as a saturating delta on top of the lowest count */
+static uint8_t ec_delta[FTL_MAX_BLOCKS];
+static uint32_t ec_base = 0;
+
+/* physical blocks not holding live data */
+static uint32_t free_blocks[FTL_MAX_BLOCKS / 32];
+
+/* free blocks that still hold superseded data, a format has to erase them too */
+static uint32_t stale_blocks[FTL_MAX_BLOCKS / 32];
+
+static uint32_t alloc_seq = 0;
+static uint32_t allocs_since_wl = 0;
+static uint32_t static_moves = 0;
+
+/* free block already handed to the background eraser for the next allocation */
+static int next_free = -1;
+
+static off_t append_head = 0;
+static bool head_known = false;
+
+/* checkpoints: slot blocks follow the last physical block of the FTL */
+static ftl_ckpt_hdr_t ckpt_hdr;
+static uint8_t ckpt_page[FTL_MAX_PAGE_BYTES];
+static uint32_t ckpt_data_bytes;    // image bytes per page
+static uint32_t ckpt_pages;         // pages per checkpoint
+static uint32_t ckpt_slot = 0;      // slot the next checkpoint goes to
+static uint32_t ckpt_next = 0;      // first page of the next checkpoint in that slot
+static uint32_t ckpt_seq = 0;
+static bool ckpt_enabled = false;
+static bool ckpt_head = false;     // the mount restored a checkpoint that knew the append head
+
+/* erase pool of the newest checkpoint, the only blocks allocations may take */
+static uint16_t pool[FTL_CKPT_POOL];
+static uint8_t pool_count = 0;
+
+static K_MUTEX_DEFINE(ftl_lock);
+
+/* background scrubber */
+#define FTL_SCRUB_STACK_SIZE  1024
+#define FTL_SCRUB_PRIORITY    K_LOWEST_APPLICATION_THREAD_PRIO
+
+K_THREAD_STACK_DEFINE(ftl_scrub_stack, FTL_SCRUB_STACK_SIZE);
+static struct k_thread ftl_scrub_thread;
+static bool scrub_started = false;
+
+static int64_t last_activity = 0;
+static uint32_t scrub_cursor = 0;
+static uint32_t scrub_left = 0;
+static int64_t scrub_pass_start = 0;
+static uint32_t refreshed_blocks = 0;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool ftl_is_free(uint32_t p)
+{
+    return (free_blocks[p / 32] & BIT(p % 32)) != 0;
+}
+
+
+static void ftl_set_free(uint32_t p, bool is_free)
+{
+    if (is_free) {
+        free_blocks[p / 32] |= BIT(p % 32);
+    } else {
+        free_blocks[p / 32] &= ~BIT(p % 32);
+    }
+}
+
+
+static void ftl_set_stale(uint32_t p, bool is_stale)
+{
+    if (is_stale) {
+        stale_blocks[p / 32] |= BIT(p % 32);
+    } else {
+        stale_blocks[p / 32] &= ~BIT(p % 32);
+    }
+}
+
+
+static uint32_t ftl_ec_get(uint32_t p)
+{
+    return ec_base + ec_delta[p];
+}
+
+
+static void ftl_ec_set(uint32_t p, uint32_t ec)
+{
+    ec_delta[p] = (ec <= ec_base) ? 0 : MIN(ec - ec_base, UINT8_MAX);
+}
+
+
+/*
+ * ftl_ec_rebase: moves ec_base up to the lowest erase count so the deltas keep headroom
+ */
+static void ftl_ec_rebase(void)
+{
+    uint8_t min_delta = UINT8_MAX;
+
+    for (uint32_t p = 0; p < num_phys; p++) {
+        min_delta = MIN(min_delta, ec_delta[p]);
+    }
+
+    if (min_delta == 0) {
+        return;
+    }
+
+    for (uint32_t p = 0; p < num_phys; p++) {
+        ec_delta[p] -= min_delta;
+    }
+    ec_base += min_delta;
+}
+
+
+static uint16_t ftl_oob_crc(const ftl_oob_t *oob)
+{
+    return crc16_ccitt(0xFFFF, (const uint8_t *)oob, offsetof(ftl_oob_t, crc));
+}
+
+
+static bool ftl_oob_read(uint32_t p, ftl_oob_t *oob)
+{
+    /* an uncorrectable read still hands out the bytes, the CRC decides */
+    int rc = mt29f_oob_read((off_t)p * bytes_per_block, (uint8_t *)oob, sizeof(*oob));
+    if (rc < 0 && rc != -EBADMSG) {
+        return false;
+    }
+
+    return oob->magic == FTL_OOB_MAGIC && oob->crc == ftl_oob_crc(oob);
+}
+
+
+/*
+ * ftl_oob_committed: false for the target of a block move that was cut short
+ */
+static bool ftl_oob_committed(uint32_t p, const ftl_oob_t *oob)
+{
+    if (oob->moved_pages <= 1) {
+        return true;
+    }
+    if (oob->moved_pages > pages_per_block) {
+        return false;
+    }
+
+    ftl_move_rec_t rec;
+    int rc = mt29f_oob_read((off_t)p * bytes_per_block + (off_t)(oob->moved_pages - 1) * bytes_per_page,
+                            (uint8_t *)&rec, sizeof(rec));
+    if (rc < 0 && rc != -EBADMSG) {
+        return false;
+    }
+
+    return rec.magic == FTL_MOVE_MAGIC && rec.seq == oob->seq;
+}
+
+
+/*
+ * ftl_map_block: points `vblock` at physical block `p` and releases the old one
+ */
+static void ftl_map_block(uint16_t vblock, uint32_t p)
+{
+    uint16_t old = map[vblock];
+
+    map[vblock] = p;
+    ftl_set_free(p, false);
+    ftl_set_stale(p, false);
+
+    if (old != FTL_UNMAPPED) {
+        ftl_set_free(old, true);
+        ftl_set_stale(old, true);
+    }
+}
+
+
+/*
+ * ftl_pick_free: free block with the lowest (`coldest`) or highest erase count
+ *
+ * @param die   only consider blocks on this die, or -1 for any die
+ */
+static int ftl_pick_free(int die, bool coldest)
+{
+    int best = -ENOSPC;
+
+    for (uint32_t p = 0; p < num_phys; p++) {
+        if (!ftl_is_free(p) || (int)p == next_free) {
+            continue;
+        }
+        if (die >= 0 && mt29f_get_block_die(p) != die) {
+            continue;
+        }
+        if (best < 0 ||
+            (coldest && ec_delta[p] < ec_delta[best]) ||
+            (!coldest && ec_delta[p] > ec_delta[best])) {
+            best = p;
+        }
+    }
+
+    return best;
+}
+
+
+/*
+ * ftl_pick_pool: like ftl_pick_free(), but only among the erase pool blocks
+ *
+ * Without checkpoints every free block is fair game.
+ */
+static int ftl_pick_pool(int die, bool coldest)
+{
+    if (!ckpt_enabled) {
+        return ftl_pick_free(die, coldest);
+    }
+
+    int best = -ENOSPC;
+
+    for (uint8_t i = 0; i < pool_count; i++) {
+        const uint32_t p = pool[i];
+
+        if (!ftl_is_free(p) || (int)p == next_free) {
+            continue;
+        }
+        if (die >= 0 && mt29f_get_block_die(p) != die) {
+            continue;
+        }
+        if (best < 0 ||
+            (coldest && ec_delta[p] < ec_delta[best]) ||
+            (!coldest && ec_delta[p] > ec_delta[best])) {
+            best = p;
+        }
+    }
+
+    return best;
+}
+
+
+/*
+ * ftl_pool_left: erase pool blocks that are still free, including `next_free`
+ */
+static uint8_t ftl_pool_left(void)
+{
+    uint8_t left = 0;
+
+    for (uint8_t i = 0; i < pool_count; i++) {
+        if (ftl_is_free(pool[i])) {
+            left++;
+        }
+    }
+
+    return left;
+}
+
+
+/*
+ * ftl_fill_pool: picks the erase pool for the next checkpoint
+ *
+ * The pre-erased `next_free` stays first, then the most worn free block of every die
+ * (static wear leveling moves cold data onto those), then the least worn free blocks.
+ */
+static uint8_t ftl_fill_pool(uint16_t *out)
+{
+    uint8_t n = 0;
+
+    if (next_free >= 0 && ftl_is_free(next_free)) {
+        out[n++] = next_free;
+    }
+
+    /* ftl_pick_free() skips `next_free`, so it must not be taken twice below */
+    const int prepared = next_free;
+    next_free = -1;
+    if (n > 0) {
+        ftl_set_free(out[0], false);
+    }
+
+    for (uint8_t die = 0; die < num_dies && n < FTL_CKPT_POOL; die++) {
+        int p = ftl_pick_free(die, false);
+        if (p >= 0) {
+            out[n++] = p;
+            ftl_set_free(p, false);
+        }
+    }
+
+    /* alternate the dies, so the striped log finds pool blocks on both */
+    while (n < FTL_CKPT_POOL) {
+        int p = ftl_pick_free(n % num_dies, true);
+        if (p < 0) {
+            p = ftl_pick_free(-1, true);
+        }
+        if (p < 0) {
+            break;
+        }
+        out[n++] = p;
+        ftl_set_free(p, false);
+    }
+
+    /* picked blocks were only hidden from the search */
+    for (uint8_t i = 0; i < n; i++) {
+        ftl_set_free(out[i], true);
+    }
+    next_free = prepared;
+
+    return n;
+}
+
+
+static off_t ftl_ckpt_addr(uint32_t slot, uint32_t page)
+{
+    return (off_t)(num_phys + slot) * bytes_per_block + (off_t)page * bytes_per_page;
+}
+
+
+/*
+ * ftl_ckpt_copy: moves `len` bytes at `pos` of the checkpoint image between RAM and `buf`
+ */
+static void ftl_ckpt_copy(size_t pos, uint8_t *buf, size_t len, bool save)
+{
+    uint8_t *regions[] = { (uint8_t *)&ckpt_hdr, (uint8_t *)map, ec_delta, (uint8_t *)stale_blocks };
+    const size_t sizes[] = {
+        sizeof(ckpt_hdr),
+        num_virt * sizeof(map[0]),
+        num_phys * sizeof(ec_delta[0]),
+        DIV_ROUND_UP(num_phys, 32) * sizeof(stale_blocks[0])
+    };
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(regions) && len > 0; i++) {
+        if (pos >= sizes[i]) {
+            pos -= sizes[i];
+            continue;
+        }
+
+        const size_t n = MIN(len, sizes[i] - pos);
+        if (save) {
+            memcpy(buf, &regions[i][pos], n);
+        } else {
+            memcpy(&regions[i][pos], buf, n);
+        }
+
+        buf += n;
+        len -= n;
+        pos = 0;
+    }
+}
+
+
+static size_t ftl_ckpt_image_size(void)
+{
+    return sizeof(ckpt_hdr) + num_virt * sizeof(map[0]) + num_phys * sizeof(ec_delta[0]) +
+           DIV_ROUND_UP(num_phys, 32) * sizeof(stale_blocks[0]);
+}
+
+
+static uint32_t ftl_ckpt_crc(void)
+{
+    uint32_t crc = crc32_ieee((const uint8_t *)&ckpt_hdr, offsetof(ftl_ckpt_hdr_t, crc));
+    crc = crc32_ieee_update(crc, (const uint8_t *)map, num_virt * sizeof(map[0]));
+    crc = crc32_ieee_update(crc, ec_delta, num_phys * sizeof(ec_delta[0]));
+    return crc32_ieee_update(crc, (const uint8_t *)stale_blocks,
+                             DIV_ROUND_UP(num_phys, 32) * sizeof(stale_blocks[0]));
+}
+
+
+/*
+ * ftl_ckpt_peek: sequence number of the `index`-th checkpoint of a slot, if it was programmed
+ */
+static bool ftl_ckpt_peek(uint32_t slot, uint32_t index, uint32_t *seq)
+{
+    int rc = mt29f_read(ftl_ckpt_addr(slot, index * ckpt_pages), ckpt_page, bytes_per_page);
+    if (rc < 0 && rc != -EBADMSG) {
+        return false;
+    }
+
+    ftl_ckpt_hdr_t hdr;
+    memcpy(&hdr, ckpt_page, sizeof(hdr));
+    *seq = hdr.seq;
+
+    return hdr.magic == FTL_CKPT_MAGIC;
+}
+
+
+/*
+ * ftl_ckpt_load: reads a checkpoint straight into the FTL state and checks it
+ *
+ * A failed load leaves the state garbled, the caller falls back to another copy or
+ * to the scan.
+ */
+static bool ftl_ckpt_load(uint32_t slot, uint32_t index)
+{
+    const size_t image = ftl_ckpt_image_size();
+
+    for (uint32_t i = 0; i < ckpt_pages; i++) {
+        int rc = mt29f_read(ftl_ckpt_addr(slot, index * ckpt_pages + i), ckpt_page, bytes_per_page);
+        if (rc < 0) {
+            return false;
+        }
+
+        const size_t pos = i * ckpt_data_bytes;
+        ftl_ckpt_copy(pos, ckpt_page, MIN(ckpt_data_bytes, image - pos), false);
+    }
+
+    return ckpt_hdr.magic == FTL_CKPT_MAGIC &&
+           ckpt_hdr.num_phys == num_phys &&
+           ckpt_hdr.num_virt == num_virt &&
+           ckpt_hdr.crc == ftl_ckpt_crc();
+}
+
+
+/*
+ * ftl_ckpt_write: writes the FTL state with a fresh erase pool to the next checkpoint slot
+ *
+ * Only called where the map matches flash, i.e. never between an allocation and the
+ * write of its first page. If neither slot takes the checkpoint, both are erased so the
+ * next mount scans, and allocations stop being restricted to the pool.
+ */
+static int ftl_ckpt_write(void)
+{
+    uint16_t new_pool[FTL_CKPT_POOL];
+    const uint8_t new_count = ftl_fill_pool(new_pool);
+    const size_t image = ftl_ckpt_image_size();
+    int rc = -EIO;
+
+    ckpt_hdr.magic = FTL_CKPT_MAGIC;
+    ckpt_hdr.seq = ckpt_seq;
+    ckpt_hdr.alloc_seq = alloc_seq;
+    ckpt_hdr.ec_base = ec_base;
+    ckpt_hdr.append_head = head_known ? append_head : FTL_NO_HEAD;
+    ckpt_hdr.num_phys = num_phys;
+    ckpt_hdr.num_virt = num_virt;
+    memset(ckpt_hdr.pool, 0xFF, sizeof(ckpt_hdr.pool));
+    memcpy(ckpt_hdr.pool, new_pool, new_count * sizeof(new_pool[0]));
+    ckpt_hdr.crc = ftl_ckpt_crc();
+
+    for (uint32_t attempt = 0; attempt < FTL_CKPT_SLOTS; attempt++) {
+        /* slot full: the other one is erased and takes over, the newest copy survives */
+        if (ckpt_next + ckpt_pages > pages_per_block) {
+            ckpt_slot = (ckpt_slot + 1) % FTL_CKPT_SLOTS;
+            ckpt_next = 0;
+        }
+
+        if (ckpt_next == 0) {
+            rc = mt29f_erase_block(ftl_ckpt_addr(ckpt_slot, 0));
+        } else {
+            rc = 0;
+        }
+
+        for (uint32_t i = 0; i < ckpt_pages && rc == 0; i++) {
+            const size_t pos = i * ckpt_data_bytes;
+
+            memset(ckpt_page, 0xFF, bytes_per_page);
+            ftl_ckpt_copy(pos, ckpt_page, MIN(ckpt_data_bytes, image - pos), true);
+            rc = mt29f_write(ftl_ckpt_addr(ckpt_slot, ckpt_next + i), ckpt_page, bytes_per_page);
+        }
+
+        if (rc == 0) {
+            ckpt_next += ckpt_pages;
+            ckpt_seq++;
+            memcpy(pool, new_pool, sizeof(pool));
+            pool_count = new_count;
+            return 0;
+        }
+
+        LOG_WRN("Checkpoint write to slot %d failed: %d", ckpt_slot, rc);
+        ckpt_next = pages_per_block;
+    }
+
+    LOG_ERR("Checkpoints disabled, the next mount scans all blocks");
+    for (uint32_t slot = 0; slot < FTL_CKPT_SLOTS; slot++) {
+        mt29f_erase_block(ftl_ckpt_addr(slot, 0));
+    }
+    ckpt_enabled = false;
+
+    return rc;
+}
+
+
+/*
+ * ftl_ckpt_replay: applies the allocations made from the erase pool after the checkpoint
+ */
+static uint32_t ftl_ckpt_replay(void)
+{
+    ftl_oob_t oob[FTL_CKPT_POOL];
+    bool fresh[FTL_CKPT_POOL];
+    uint32_t replayed = 0;
+
+    for (uint8_t i = 0; i < pool_count; i++) {
+        fresh[i] = ftl_oob_read(pool[i], &oob[i]) && oob[i].vblock < num_virt &&
+                   oob[i].seq >= ckpt_hdr.alloc_seq && ftl_oob_committed(pool[i], &oob[i]);
+    }
+
+    /* oldest allocation first, so a block remapped twice ends up on its newest copy */
+    for (;;) {
+        int next = -1;
+        for (uint8_t i = 0; i < pool_count; i++) {
+            if (fresh[i] && (next < 0 || oob[i].seq < oob[next].seq)) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+
+        fresh[next] = false;
+        ftl_ec_set(pool[next], oob[next].erase_count);
+        ftl_map_block(oob[next].vblock, pool[next]);
+        alloc_seq = MAX(alloc_seq, oob[next].seq + 1);
+        replayed++;
+    }
+
+    return replayed;
+}
+
+
+/*
+ * ftl_ckpt_restore: loads the newest valid checkpoint and replays the pool
+ *
+ * Checkpoints fill a slot front to back, so a binary search over the first page of each
+ * finds the newest one. A torn copy falls back to the one before it.
+ */
+static bool ftl_ckpt_restore(void)
+{
+    const uint32_t per_slot = pages_per_block / ckpt_pages;
+
+    uint32_t first_seq[FTL_CKPT_SLOTS];
+    uint32_t last_seq[FTL_CKPT_SLOTS];
+    uint32_t last[FTL_CKPT_SLOTS];
+    bool used[FTL_CKPT_SLOTS];
+    int newest = -1;
+
+    /* with no checkpoint at all, the first one erases and starts a slot */
+    ckpt_slot = 0;
+    ckpt_next = pages_per_block;
+    ckpt_seq = 0;
+
+    for (uint32_t slot = 0; slot < FTL_CKPT_SLOTS; slot++) {
+        used[slot] = ftl_ckpt_peek(slot, 0, &first_seq[slot]);
+        if (!used[slot]) {
+            continue;
+        }
+
+        uint32_t lo = 0;
+        uint32_t hi = per_slot - 1;
+        last_seq[slot] = first_seq[slot];
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            uint32_t seq;
+            if (ftl_ckpt_peek(slot, mid, &seq)) {
+                lo = mid;
+                last_seq[slot] = seq;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        last[slot] = lo;
+
+        if (newest < 0 || first_seq[slot] > first_seq[newest]) {
+            newest = slot;
+        }
+    }
+
+    if (newest < 0) {
+        return false;
+    }
+
+    /* new checkpoints go behind the newest ones, torn or not */
+    ckpt_slot = newest;
+    ckpt_next = (last[newest] + 1) * ckpt_pages;
+
+    for (uint32_t n = 0; n < FTL_CKPT_SLOTS; n++) {
+        const uint32_t slot = (newest + n) % FTL_CKPT_SLOTS;
+        if (!used[slot]) {
+            continue;
+        }
+
+        for (uint32_t index = last[slot] + 1; index-- > 0;) {
+            if (ftl_ckpt_load(slot, index)) {
+                ckpt_seq = last_seq[newest] + 1;
+                goto loaded;
+            }
+        }
+    }
+    return false;
+
+loaded:
+    ec_base = ckpt_hdr.ec_base;
+    alloc_seq = ckpt_hdr.alloc_seq;
+    head_known = (ckpt_hdr.append_head != FTL_NO_HEAD);
+    append_head = head_known ? ckpt_hdr.append_head : 0;
+
+    pool_count = 0;
+    for (uint8_t i = 0; i < FTL_CKPT_POOL; i++) {
+        if (ckpt_hdr.pool[i] < num_phys) {
+            pool[pool_count++] = ckpt_hdr.pool[i];
+        }
+    }
+
+    /* every block that is not mapped is free */
+    memset(free_blocks, 0xFF, sizeof(free_blocks));
+    for (uint32_t v = 0; v < num_virt; v++) {
+        if (map[v] != FTL_UNMAPPED) {
+            ftl_set_free(map[v], false);
+        }
+    }
+
+    const uint32_t replayed = ftl_ckpt_replay();
+    LOG_INF("FTL checkpoint %u restored, %u allocations replayed", ckpt_hdr.seq, replayed);
+
+    return true;
+}
+
+
+/*
+ * ftl_scan: rebuilds the map, erase counters and free set from the OOB of every block
+ */
+static void ftl_scan(void)
+{
+    /* pass 1: mappings, newest allocation wins, and the lowest erase count */
+    uint32_t min_ec = UINT32_MAX;
+    for (uint32_t p = 0; p < num_phys; p++) {
+        ftl_oob_t oob;
+        if (!ftl_oob_read(p, &oob) || oob.vblock >= num_virt) {
+            continue;
+        }
+
+        min_ec = MIN(min_ec, oob.erase_count);
+        alloc_seq = MAX(alloc_seq, oob.seq + 1);
+
+        if (!ftl_oob_committed(p, &oob)) {
+            continue;
+        }
+
+        if (map[oob.vblock] != FTL_UNMAPPED) {
+            ftl_oob_t other;
+            if (ftl_oob_read(map[oob.vblock], &other) && other.seq > oob.seq) {
+                continue;
+            }
+        }
+        map[oob.vblock] = p;
+    }
+    ec_base = (min_ec == UINT32_MAX) ? 0 : min_ec;
+
+    /* pass 2: erase counters and the free set */
+    for (uint32_t p = 0; p < num_phys; p++) {
+        ftl_oob_t oob;
+        bool valid = ftl_oob_read(p, &oob);
+
+        const bool live = valid && oob.vblock < num_virt && map[oob.vblock] == p;
+
+        ftl_ec_set(p, valid ? oob.erase_count : ec_base);
+        ftl_set_free(p, !live);
+        ftl_set_stale(p, valid && !live);
+    }
+}
+
+
+/*
+ * ftl_prepare_next: picks the next allocation target and lets the driver erase it in the background
+ *
+ * Consecutive log blocks alternate between the dies: the next block is erased while the
+ * current one is written, and reads of recent data on one die never queue behind that erase.
+ */
+static void ftl_prepare_next(void)
+{
+    const uint16_t head = append_head / bytes_per_block;
+    int die = -1;
+    if (num_dies > 1 && head < num_virt && map[head] != FTL_UNMAPPED) {
+        die = (mt29f_get_block_die(map[head]) + 1) % num_dies;
+    }
+
+    next_free = ftl_pick_pool(die, true);
+    if (next_free < 0 && die >= 0) {
+        next_free = ftl_pick_pool(-1, true);
+    }
+    if (next_free >= 0) {
+        mt29f_erase_block_async((off_t)next_free * bytes_per_block);
+    }
+}
+
+
+static void ftl_fill_oob(ftl_oob_t *oob, uint32_t p, uint16_t vblock)
+{
+    oob->magic = FTL_OOB_MAGIC;
+    oob->erase_count = ftl_ec_get(p);
+    oob->seq = alloc_seq++;
+    oob->vblock = vblock;
+    oob->moved_pages = 0;
+    oob->crc = ftl_oob_crc(oob);
+}
+
+
+/*
+ * ftl_pages_used: programmed pages of a virtual block, only the head block is partial
+ */
+static uint32_t ftl_pages_used(uint32_t v)
+{
+    const uint32_t pages_per_block = bytes_per_block / bytes_per_page;
+
+    if (v == append_head / bytes_per_block) {
+        return (append_head % bytes_per_block) / bytes_per_page;
+    }
+    return pages_per_block;
+}
+
+
+/*
+ * ftl_move_block: copies virtual block `v` onto free block `dst` with internal data moves
+ *
+ * The on-die ECC corrects every page on the way into the cache register, so the copy
+ * also rewrites marginal data. Only programmed pages are moved; the rest stays erased
+ * for the append stream. The move commits with the record on its last page, the source
+ * stays mapped until then and out of the erase pool until the next checkpoint.
+ */
+static int ftl_move_block(uint32_t v, uint32_t dst)
+{
+    const uint32_t src = map[v];
+    const uint32_t pages = ftl_pages_used(v);
+
+    /* the head block is about to be replaced by the next append anyway */
+    if (pages == 0) {
+        return -ENODATA;
+    }
+
+    int rc = mt29f_erase_block((off_t)dst * bytes_per_block);
+    if (rc != 0) {
+        return rc;
+    }
+    if (ec_delta[dst] < UINT8_MAX) {
+        ec_delta[dst]++;
+    }
+
+    ftl_oob_t oob;
+    ftl_fill_oob(&oob, dst, v);
+    oob.moved_pages = pages;
+    oob.crc = ftl_oob_crc(&oob);
+
+    const ftl_move_rec_t rec = { .magic = FTL_MOVE_MAGIC, .seq = oob.seq };
+
+    for (uint32_t page = 0; page < pages; page++) {
+        const off_t from = (off_t)src * bytes_per_block + (off_t)page * bytes_per_page;
+        const off_t to = (off_t)dst * bytes_per_block + (off_t)page * bytes_per_page;
+
+        /* page 0 carries the FTL metadata and the last page the commit record, swap them in
+         * while the page sits in the cache */
+        const uint8_t *patch = NULL;
+        size_t patch_len = 0;
+        if (page == 0) {
+            patch = (const uint8_t *)&oob;
+            patch_len = sizeof(oob);
+        } else if (page == pages - 1) {
+            patch = (const uint8_t *)&rec;
+            patch_len = sizeof(rec);
+        }
+
+        rc = mt29f_page_copy(from, to, patch, patch_len);
+        if (rc != 0) {
+            LOG_ERR("Block move %d -> %d failed at page %d: %d", src, dst, page, rc);
+            return rc;
+        }
+    }
+
+    ftl_map_block(v, dst);
+
+    return 0;
+}
+
+
+/*
+ * ftl_static_wear_level: moves the coldest data block onto the most worn free block
+ *
+ * Data that never gets rewritten would otherwise pin its block at a low erase count
+ * forever while the rest of the chip wears out.
+ */
+static void ftl_static_wear_level(void)
+{
+    ftl_ec_rebase();
+
+    int cold_v = -1;
+    for (uint32_t v = 0; v < num_virt; v++) {
+        if (map[v] != FTL_UNMAPPED && (cold_v < 0 || ec_delta[map[v]] < ec_delta[map[cold_v]])) {
+            cold_v = v;
+        }
+    }
+    if (cold_v < 0) {
+        return;
+    }
+
+    const uint32_t cold = map[cold_v];
+
+    /* internal data moves only work inside one die */
+    int hot = ftl_pick_pool(mt29f_get_block_die(cold), false);
+    if (hot < 0 || ftl_ec_get(hot) - ftl_ec_get(cold) < FTL_WL_THRESHOLD) {
+        return;
+    }
+
+    LOG_DBG("Static WL: vblock %d %d (ec %d) -> %d (ec %d)",
+            cold_v, cold, ftl_ec_get(cold), hot, ftl_ec_get(hot));
+
+    if (ftl_move_block(cold_v, hot) == 0) {
+        static_moves++;
+    }
+}
+
+
+/*
+ * ftl_refresh_block: rewrites the data of physical block `p` onto the least worn free
+ * block of the same die
+ */
+static void ftl_refresh_block(uint32_t p)
+{
+    int v = -1;
+    for (uint32_t i = 0; i < num_virt; i++) {
+        if (map[i] == p) {
+            v = i;
+            break;
+        }
+    }
+
+    /* already moved or freed since the ECC report */
+    if (v < 0) {
+        return;
+    }
+
+    int dst = ftl_pick_pool(mt29f_get_block_die(p), true);
+    if (dst < 0 && ckpt_enabled && ftl_ckpt_write() == 0) {
+        dst = ftl_pick_pool(mt29f_get_block_die(p), true);
+    }
+    if (dst < 0) {
+        LOG_WRN("No free block on die %d to refresh block %d", mt29f_get_block_die(p), p);
+        return;
+    }
+
+    LOG_INF("Refreshing vblock %d: %d -> %d", v, p, dst);
+
+    if (ftl_move_block(v, dst) == 0) {
+        refreshed_blocks++;
+    }
+}
+
+
+/*
+ * ftl_scrub_block: checks the ECC status of every programmed page of the next cold block
+ *
+ * Reading a few OOB bytes is enough: the on-die ECC status covers the whole page that
+ * was loaded into the cache register, so no page data needs to cross the bus.
+ */
+static void ftl_scrub_block(void)
+{
+    /* a full pass is done, wait for the next one to be due */
+    if (scrub_left == 0) {
+        if (k_uptime_get() - scrub_pass_start < FTL_SCRUB_PASS_MS) {
+            return;
+        }
+        scrub_left = num_virt;
+        scrub_pass_start = k_uptime_get();
+    }
+
+    while (scrub_left > 0) {
+        const uint32_t v = scrub_cursor;
+        scrub_cursor = (scrub_cursor + 1) % num_virt;
+        scrub_left--;
+
+        if (map[v] == FTL_UNMAPPED) {
+            continue;
+        }
+
+        const uint32_t p = map[v];
+        const uint32_t pages = ftl_pages_used(v);
+
+        for (uint32_t page = 0; page < pages; page++) {
+            uint8_t probe;
+            int rc = mt29f_oob_read((off_t)p * bytes_per_block + (off_t)page * bytes_per_page, &probe, 1);
+
+            if (rc == MT29F_ECC_REFRESH || rc == -EBADMSG) {
+                ftl_refresh_block(p);
+                break;
+            }
+        }
+        return;
+    }
+}
+
+
+/*
+ * ftl_scrub_thread_entry: refreshes blocks flagged by reads and walks cold data while idle
+ */
+static void ftl_scrub_thread_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    for (;;) {
+        k_msleep(FTL_SCRUB_PERIOD_MS);
+
+        uint32_t p;
+        while (mt29f_refresh_pop(&p) == 0) {
+            k_mutex_lock(&ftl_lock, K_FOREVER);
+            if (p < num_phys) {
+                ftl_refresh_block(p);
+            }
+            k_mutex_unlock(&ftl_lock);
+        }
+
+        if (k_uptime_get() - last_activity < FTL_SCRUB_IDLE_MS) {
+            continue;
+        }
+
+        k_mutex_lock(&ftl_lock, K_FOREVER);
+        ftl_scrub_block();
+        k_mutex_unlock(&ftl_lock);
+    }
+}
+
+
+/*
+ * ftl_alloc: gives `vblock` a freshly erased physical block (dynamic wear leveling)
+ */
+static int ftl_alloc(uint16_t vblock)
+{
+    /* the pool runs dry with this allocation: record a new one while the map still matches flash */
+    if (ckpt_enabled && ftl_pool_left() <= 1) {
+        ftl_ckpt_write();
+    }
+
+    int p = next_free;
+    next_free = -1;
+
+    if (p < 0 || !ftl_is_free(p)) {
+        p = ftl_pick_pool(-1, true);
+    }
+    if (p < 0) {
+        LOG_ERR("No free blocks");
+        return p;
+    }
+
+    /* either the background eraser or the first page write erases it */
+    if (ec_delta[p] < UINT8_MAX) {
+        ec_delta[p]++;
+    }
+
+    ftl_map_block(vblock, p);
+
+    if (++allocs_since_wl >= FTL_WL_CHECK_PERIOD) {
+        allocs_since_wl = 0;
+        ftl_static_wear_level();
+    }
+
+    ftl_prepare_next();
+
+    return 0;
+}
+
+
+/*
+ * ftl_write_page: programs one page at a virtual offset from the parts of its content
+ *
+ * The FTL metadata of page 0 rides along in the same program, so a new block costs one
+ * program operation instead of a page write followed by a partial OOB write.
+ */
+static int ftl_write_page(off_t offset, const mt29f_part_t *parts, size_t count)
+{
+    const uint16_t vblock = offset / bytes_per_block;
+    const off_t in_block = offset % bytes_per_block;
+    const bool first_page = (in_block == 0);
+
+    if (first_page || map[vblock] == FTL_UNMAPPED) {
+        int rc = ftl_alloc(vblock);
+        if (rc != 0) {
+            return rc;
+        }
+
+        /* the driver only erases ahead of page 0 */
+        if (!first_page) {
+            rc = mt29f_erase_block((off_t)map[vblock] * bytes_per_block);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    const uint32_t p = map[vblock];
+    ftl_oob_t oob;
+    if (first_page) {
+        ftl_fill_oob(&oob, p, vblock);
+    }
+
+    return mt29f_write_parts((off_t)p * bytes_per_block + in_block, parts, count,
+                             first_page ? (const uint8_t *)&oob : NULL, first_page ? sizeof(oob) : 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL FUNCTIONS ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * ftl_init: restores the newest checkpoint, or rebuilds the map from the OOB metadata of every physical block
+ */
+int ftl_init(const mt29f_cfg_t *cfg)
+{
+    bytes_per_page = cfg->bytes_per_page;
+    pages_per_block = cfg->pages_per_block;
+    bytes_per_block = bytes_per_page * pages_per_block;
+    num_dies = cfg->num_dies;
+
+    if (!mt29f_is_ready()) {
+        LOG_ERR("MT29F not initialized");
+        return -ENODEV;
+    }
+
+    uint32_t blocks = mt29f_get_num_blocks();
+    if (FTL_PARTITION_BYTES > 0) {
+        blocks = MIN(blocks, FTL_PARTITION_BYTES / (pages_per_block * (bytes_per_page - cfg->oob_bytes)));
+    }
+    if (blocks <= FTL_CKPT_SLOTS + FTL_FREE_BLOCKS) {
+        LOG_ERR("FTL partition too small: %d blocks", blocks);
+        return -EINVAL;
+    }
+    num_phys = MIN(blocks, FTL_MAX_BLOCKS) - FTL_CKPT_SLOTS;
+    num_virt = num_phys - FTL_FREE_BLOCKS;
+
+    ckpt_data_bytes = bytes_per_page - cfg->oob_bytes;
+    ckpt_pages = DIV_ROUND_UP(ftl_ckpt_image_size(), ckpt_data_bytes);
+    ckpt_enabled = (bytes_per_page <= FTL_MAX_PAGE_BYTES) && (ckpt_pages <= pages_per_block);
+
+    next_free = -1;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+
+    const bool restored = ckpt_enabled && ftl_ckpt_restore();
+    ckpt_head = restored && head_known;
+
+    if (!restored) {
+        memset(map, 0xFF, sizeof(map));
+        memset(free_blocks, 0, sizeof(free_blocks));
+        memset(stale_blocks, 0, sizeof(stale_blocks));
+        alloc_seq = 0;
+        append_head = 0;
+        head_known = false;
+
+        ftl_scan();
+
+        /* the next mount can skip the scan */
+        if (ckpt_enabled) {
+            ftl_ckpt_write();
+        }
+    }
+
+    ftl_prepare_next();
+
+    /* oldest data sits right after the append head, walk it first */
+    scrub_cursor = (append_head / bytes_per_block + 1) % num_virt;
+    scrub_left = num_virt;
+    scrub_pass_start = k_uptime_get();
+
+    k_mutex_unlock(&ftl_lock);
+
+    if (!scrub_started) {
+        scrub_started = true;
+        k_thread_create(&ftl_scrub_thread, ftl_scrub_stack,
+                        K_THREAD_STACK_SIZEOF(ftl_scrub_stack),
+                        ftl_scrub_thread_entry,
+                        NULL, NULL, NULL,
+                        FTL_SCRUB_PRIORITY, 0, K_NO_WAIT);
+        k_thread_name_set(&ftl_scrub_thread, "ftl_scrub");
+    }
+
+    LOG_INF("FTL up: %d virtual / %d physical blocks, erase count base %d", num_virt, num_phys, ec_base);
+    return 0;
+}
+
+
+/*
+ * ftl_read: reads whole pages, one physical block run at a time
+ *
+ * Corrected bit errors are handled in the background by the scrubber, only an
+ * uncorrectable page is reported (-EBADMSG, the rest of the range is still read).
+ */
+int ftl_read(off_t offset, uint8_t *data, size_t len)
+{
+    int rc = 0;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+    last_activity = k_uptime_get();
+
+    while (len > 0 && (rc == 0 || rc == -EBADMSG)) {
+        const uint16_t vblock = offset / bytes_per_block;
+        const off_t in_block = offset % bytes_per_block;
+        const size_t run = MIN(len, (size_t)(bytes_per_block - in_block));
+
+        if (vblock >= num_virt) {
+            rc = -EINVAL;
+        } else if (map[vblock] == FTL_UNMAPPED) {
+            memset(data, 0xFF, run);
+        } else {
+            int ecc = mt29f_read((off_t)map[vblock] * bytes_per_block + in_block, data, run);
+            if (ecc < 0) {
+                rc = ecc;
+            }
+        }
+
+        offset += run;
+        data += run;
+        len -= run;
+    }
+
+    k_mutex_unlock(&ftl_lock);
+
+    return rc;
+}
+
+
+/*
+ * ftl_append_start: moves the virtual append head
+ */
+int ftl_append_start(off_t offset)
+{
+    if (offset % bytes_per_page != 0 || offset > ftl_get_size()) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+    append_head = offset;
+    head_known = true;
+    k_mutex_unlock(&ftl_lock);
+
+    return 0;
+}
+
+
+/*
+ * ftl_append: writes whole pages at the virtual append head
+ */
+int ftl_append(const uint8_t *data, size_t len)
+{
+    if (len % bytes_per_page != 0) {
+        return -EINVAL;
+    }
+
+    int rc = 0;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+    last_activity = k_uptime_get();
+
+    if (append_head + (off_t)len > ftl_get_size()) {
+        rc = -ENOSPC;
+    }
+
+    for (size_t done = 0; done < len && rc == 0; done += bytes_per_page) {
+        const mt29f_part_t page = {
+            .col = 0,
+            .len = bytes_per_page,
+            .data = &data[done]
+        };
+
+        rc = ftl_write_page(append_head, &page, 1);
+        if (rc == 0) {
+            append_head += bytes_per_page;
+        }
+    }
+
+    k_mutex_unlock(&ftl_lock);
+
+    return rc;
+}
+
+
+/*
+ * ftl_append_parts: appends one page assembled from `parts` in the NAND cache register
+ */
+int ftl_append_parts(const mt29f_part_t *parts, size_t count)
+{
+    int rc = 0;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+    last_activity = k_uptime_get();
+
+    if (append_head + (off_t)bytes_per_page > ftl_get_size()) {
+        rc = -ENOSPC;
+    } else {
+        rc = ftl_write_page(append_head, parts, count);
+        if (rc == 0) {
+            append_head += bytes_per_page;
+        }
+    }
+
+    k_mutex_unlock(&ftl_lock);
+
+    return rc;
+}
+
+
+/*
+ * ftl_append_get_head: "Getter" function for the virtual append head
+ */
+off_t ftl_append_get_head(void)
+{
+    return append_head;
+}
+
+
+/*
+ * ftl_get_num_blocks: number of virtual blocks
+ */
+uint32_t ftl_get_num_blocks(void)
+{
+    return num_virt;
+}
+
+
+/*
+ * ftl_get_size: virtual address space size
+ */
+off_t ftl_get_size(void)
+{
+    return (off_t)num_virt * bytes_per_block;
+}
+
+
+/*
+ * ftl_format: unmaps everything and erases the blocks that held data
+ *
+ * Only mapped and stale blocks are touched, so the format time scales with the data
+ * written rather than with the chip size. The driver interleaves the erases over
+ * both dies.
+ */
+void ftl_format(void)
+{
+    uint32_t batch[FTL_FORMAT_BATCH];
+    size_t count = 0;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+
+    for (uint32_t p = 0; p < num_phys; p++) {
+        const bool stale = (stale_blocks[p / 32] & BIT(p % 32)) != 0;
+
+        if (ftl_is_free(p) && !stale) {
+            continue;
+        }
+
+        batch[count++] = p;
+        if (ec_delta[p] < UINT8_MAX) {
+            ec_delta[p]++;
+        }
+        ftl_set_free(p, true);
+        ftl_set_stale(p, false);
+
+        if (count == FTL_FORMAT_BATCH) {
+            mt29f_erase_blocks(batch, count);
+            count = 0;
+        }
+    }
+
+    if (count > 0) {
+        mt29f_erase_blocks(batch, count);
+    }
+
+    memset(map, 0xFF, sizeof(map));
+    append_head = 0;
+    next_free = -1;
+
+    /* supersedes every checkpoint that still maps the erased blocks */
+    if (ckpt_enabled) {
+        ftl_ckpt_write();
+    }
+    ftl_prepare_next();
+
+    k_mutex_unlock(&ftl_lock);
+}
+
+
+/*
+ * ftl_checkpoint: writes the current state so the next mount does not have to replay it
+ */
+int ftl_checkpoint(void)
+{
+    if (!ckpt_enabled) {
+        return -ENOTSUP;
+    }
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+    int rc = ftl_ckpt_write();
+    if (next_free < 0) {
+        ftl_prepare_next();
+    }
+    k_mutex_unlock(&ftl_lock);
+
+    return rc;
+}
+
+
+/*
+ * ftl_get_checkpoint_head: append head recorded in the checkpoint the FTL was mounted from
+ */
+bool ftl_get_checkpoint_head(off_t *head)
+{
+    if (!ckpt_head) {
+        return false;
+    }
+
+    *head = append_head;
+    return true;
+}
+
+
+/*
+ * ftl_get_wear_stats: erase count spread over all physical blocks
+ */
+void ftl_get_wear_stats(ftl_wear_stats_t *stats)
+{
+    uint64_t sum = 0;
+
+    k_mutex_lock(&ftl_lock, K_FOREVER);
+
+    stats->min_erase_count = UINT32_MAX;
+    stats->max_erase_count = 0;
+
+    for (uint32_t p = 0; p < num_phys; p++) {
+        const uint32_t ec = ftl_ec_get(p);
+        stats->min_erase_count = MIN(stats->min_erase_count, ec);
+        stats->max_erase_count = MAX(stats->max_erase_count, ec);
+        sum += ec;
+    }
+
+    stats->avg_erase_count = num_phys ? sum / num_phys : 0;
+    stats->static_moves = static_moves;
+    stats->refreshed_blocks = refreshed_blocks;
+
+    k_mutex_unlock(&ftl_lock);
+}
@@ -0,0 +1,202 @@
+//*****************************************************************************
+//!
+//! @file ftl.h
+//! @author Anders Bandt
+//! @brief Wear-leveling flash translation layer between the NVS log and the MT29F driver
+//! @version 0.9
+//! @date October 2026
+//!
+//*****************************************************************************
+
+#ifndef SRC_MEMORY_FTL_H_
+#define SRC_MEMORY_FTL_H_
+
+
+/* Standard C99 stuff */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Zephyr files */
+#include <zephyr/devicetree.h>
+#include <zephyr/sys/util.h>
+
+/* My header files  */
+#include <mt29f_nand.h>
+
+
+/*
+ * The FTL only uses the blocks of the `ftl_partition` fixed partition of the MT29F
+ * (main area bytes, starting at offset 0), the rest of the chip is left to the flash
+ * device. Without that node it takes the whole chip.
+ */
+#if DT_NODE_EXISTS(DT_NODELABEL(ftl_partition))
+#define FTL_PARTITION_BYTES   DT_REG_SIZE(DT_NODELABEL(ftl_partition))
+BUILD_ASSERT(DT_REG_ADDR(DT_NODELABEL(ftl_partition)) == 0, "ftl_partition must start at offset 0");
+#else
+#define FTL_PARTITION_BYTES   0
+#endif
+
+/* main area of one MT29F block (64 pages of 2 KiB) */
+#define FTL_BLOCK_DATA_BYTES  (64 * 2048)
+
+/*
+ * Physical blocks the tables are sized for: the partition, or the 2048 blocks of the chip.
+ *
+ * RAM use: 3 bytes per block (mapping entry + erase count delta) and two bitmaps (free,
+ * stale), plus a checkpoint page buffer (FTL_MAX_PAGE_BYTES) and the 1 KB scrubber
+ * stack. That is about 8.3 KB for the 1536 block partition of the board, 10 KB for a
+ * whole chip.
+ */
+#if FTL_PARTITION_BYTES > 0
+#define FTL_MAX_BLOCKS        ROUND_UP(FTL_PARTITION_BYTES / FTL_BLOCK_DATA_BYTES, 32)
+#else
+#define FTL_MAX_BLOCKS        2048
+#endif
+
+/* largest page (main + spare area) the checkpoint buffer holds */
+#define FTL_MAX_PAGE_BYTES    2176
+
+/* physical blocks at the end of the partition that take turns holding the checkpoints */
+#define FTL_CKPT_SLOTS        2
+
+/*
+ * free blocks named by every checkpoint; allocations only take these, so a mount
+ * replays at most this many blocks and a new checkpoint is due every
+ * FTL_CKPT_POOL - 1 allocations
+ */
+#define FTL_CKPT_POOL         16
+
+/* physical blocks kept out of the virtual address space as an allocation pool */
+#define FTL_FREE_BLOCKS       32
+
+/* allowed erase count spread before cold data is moved onto worn blocks */
+#define FTL_WL_THRESHOLD      64
+
+/* block allocations between two static wear leveling checks */
+#define FTL_WL_CHECK_PERIOD   64
+
+/* blocks handed to the driver per interleaved erase pass during a format */
+#define FTL_FORMAT_BATCH      32
+
+/* scrubber wake-up period, and how long the FTL must be idle before it walks cold data */
+#define FTL_SCRUB_PERIOD_MS   1000
+#define FTL_SCRUB_IDLE_MS     5000
+
+/* minimum time between the starts of two full scrub passes over the mapped blocks */
+#define FTL_SCRUB_PASS_MS     (24 * 60 * 60 * 1000)
+
+
+/**
+ * @brief erase count statistics over all physical blocks
+ */
+typedef struct ftl_wear_stats {
+    uint32_t min_erase_count;
+    uint32_t max_erase_count;
+    uint32_t avg_erase_count;
+    uint32_t static_moves;      // blocks relocated by static wear leveling
+    uint32_t refreshed_blocks;  // blocks rewritten after a refresh-recommended ECC status
+} ftl_wear_stats_t;
+
+
+/**
+ * @brief restores the block map and erase counters from the newest checkpoint
+ *
+ * @desc without a valid checkpoint the state is rebuilt from the per-block OOB
+ *       metadata of the whole chip and a checkpoint is written right away. Also starts
+ *       the low priority scrubber that rewrites blocks whose ECC status recommends a
+ *       refresh. Cold data is walked from the oldest block on, one full pass at most
+ *       every FTL_SCRUB_PASS_MS.
+ *
+ * @return -ENODEV if the chip did not come up, -EINVAL if it is too small for the FTL
+ */
+int ftl_init(const mt29f_cfg_t *cfg);
+
+
+/**
+ * @brief reads whole pages at a virtual offset (unmapped blocks read back as erased)
+ *
+ * @return -EBADMSG if a page was uncorrectable
+ */
+int ftl_read(off_t offset, uint8_t *data, size_t len);
+
+
+/**
+ * @brief sets the virtual append head
+ */
+int ftl_append_start(off_t offset);
+
+
+/**
+ * @brief appends whole pages at the virtual append head
+ *
+ * @desc the first page of every virtual block gets a fresh physical block, picked as
+ *       the free block with the lowest erase count
+ */
+int ftl_append(const uint8_t *data, size_t len);
+
+
+/**
+ * @brief appends one page built from `parts` (see mt29f_write_parts())
+ *
+ * @desc only the bytes the parts cover go over the bus; the rest of the page stays
+ *       erased. At most MT29F_MAX_PARTS parts; the FTL metadata of page 0 is loaded
+ *       after them.
+ */
+int ftl_append_parts(const mt29f_part_t *parts, size_t count);
+
+
+/**
+ * @brief getter function for the virtual append head
+ */
+off_t ftl_append_get_head(void);
+
+
+/**
+ * @brief number of virtual blocks
+ */
+uint32_t ftl_get_num_blocks(void);
+
+
+/**
+ * @brief size of the virtual address space in bytes
+ */
+off_t ftl_get_size(void);
+
+
+/**
+ * @brief drops every mapping and erases the blocks that held data
+ *
+ * @desc blocks that were never written since the last erase are skipped
+ */
+void ftl_format(void);
+
+
+/**
+ * @brief reports the erase count spread
+ */
+void ftl_get_wear_stats(ftl_wear_stats_t *stats);
+
+
+/**
+ * @brief writes a checkpoint of the current state, e.g. before a clean shutdown
+ *
+ * @desc the FTL also writes one by itself whenever its erase pool runs out
+ *
+ * @return -ENOTSUP if checkpoints are disabled
+ */
+int ftl_checkpoint(void);
+
+
+/**
+ * @brief append head recorded in the checkpoint the last ftl_init() restored
+ *
+ * @desc the log may have moved on by at most FTL_CKPT_POOL blocks since
+ *
+ * @return false after a scan, or if the checkpoint was taken before the head was set
+ */
+bool ftl_get_checkpoint_head(off_t *head);
+
+
+#endif /* SRC_MEMORY_FTL_H_ */
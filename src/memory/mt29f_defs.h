@@ -83,6 +83,10 @@
 #define MANUFACTURER_ID  0x2C
 #define DEVICE_ID        0x24
 
+#define OOB_BAD_BLOCK_MARKER_POS  0x00  // Factory bad block marker: first spare byte of page 0 != 0xFF
+#define OOB_USER_POS              0x04  // ECC protected user metadata in the spare area
+#define OOB_USER_BYTES            0x3C
+
 #define BLOCK_OFFSET  0x40000
 #define PAGE_OFFSET   0x1000
 #define BLOCK_MASK    0x3FFFF
@@ -0,0 +1,697 @@
+//*****************************************************************************
+//!
+//! @file mt29f_emul.c
+//! @author Anders Bandt
+//! @brief MT29F SPI NAND emulator for native_sim
+//! @version 0.9
+//! @date October 2026
+//!
+//*****************************************************************************
+
+
+/* Standard C99 stuff */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Zephyr files */
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/spi_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+
+/* My header files  */
+#include "mt29f_defs.h"
+#include "mt29f_emul.h"
+
+
+LOG_MODULE_REGISTER(mt29f_emul, LOG_LEVEL_INF);
+
+
+#define DT_DRV_COMPAT micron_mt29f
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) <= 1, "Only one emulated MT29F is supported");
+
+// Geometry of the MT29F4G01 (2 x 2Gb dies)
+#define EMUL_DIES         2
+#define EMUL_BLOCKS       1024
+#define EMUL_PAGES        64
+#define EMUL_PAGE_BYTES   2176
+#define EMUL_MAIN_BYTES   2048
+
+#define EMUL_MAX_XFER     (EMUL_PAGE_BYTES + 8)
+
+// Cache read busy (tRCBSY) after READ_PAGE_CACHE_RANDOM / LAST
+#define EMUL_T_RCBSY_US   3
+#define EMUL_T_RST_US     5
+
+// Power-on values
+#define EMUL_LOCK_DEFAULT    PROT_STATUS_BP_MASK
+#define EMUL_CONFIG_DEFAULT  SEC_STATUS_BIT_ECC_EN
+
+enum {
+  BLOCK_GOOD = 0,
+  BLOCK_GROWN_BAD,
+  BLOCK_FACTORY_BAD,
+};
+
+/*
+ * The array is kept bit-inverted so that an all-zero .bss reads back as erased
+ * flash: the 285 MB only get backed by host memory once they are programmed.
+ */
+static uint8_t array[EMUL_DIES][EMUL_BLOCKS][EMUL_PAGES][EMUL_PAGE_BYTES];
+
+typedef struct mt29f_emul_die {
+  uint8_t   status;
+  uint8_t   config;
+  uint8_t   lock;
+  uint64_t  busy_until_us;
+  uint64_t  cache_busy_until_us;
+  int32_t   data_row;           // page held in the data register, -1 if none
+  uint8_t   cache[EMUL_PAGE_BYTES];
+} mt29f_emul_die_t;
+
+struct mt29f_emul_data {
+  struct k_spinlock lock;
+
+  uint8_t die;
+  mt29f_emul_die_t dies[EMUL_DIES];
+
+  uint32_t t_r_us;
+  uint32_t t_prog_us;
+  uint32_t t_bers_us;
+  uint8_t max_lines;
+
+  // First half of a wide transfer, the data phase follows in the next transaction
+  bool pending;
+  uint8_t pending_cmd;
+  uint16_t pending_col;
+
+  uint8_t bad[EMUL_DIES][EMUL_BLOCKS];
+  uint8_t nop[EMUL_DIES][EMUL_BLOCKS][EMUL_PAGES];
+  uint8_t next_page[EMUL_DIES][EMUL_BLOCKS];    // one past the highest programmed page
+  uint8_t bitflips[EMUL_DIES][EMUL_BLOCKS][EMUL_PAGES];
+  uint32_t erase_count[EMUL_DIES][EMUL_BLOCKS];
+
+  // Supply cut after this many more program or erase operations, the array then ignores both
+  bool power_cut;
+  uint32_t ops_left;
+
+  uint8_t tx[EMUL_MAX_XFER];
+  uint8_t rx[EMUL_MAX_XFER];
+};
+
+
+static uint64_t emul_now_us(void)
+{
+  return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static mt29f_emul_die_t *emul_die(struct mt29f_emul_data *data)
+{
+  return &data->dies[data->die];
+}
+
+static bool emul_die_busy(const mt29f_emul_die_t *die)
+{
+  return emul_now_us() < die->busy_until_us;
+}
+
+static uint8_t emul_status(const mt29f_emul_die_t *die)
+{
+  uint8_t status = die->status;
+
+  if (emul_die_busy(die)) {
+    status |= STATUS_BIT_OIP_MASK;
+  }
+  if (emul_now_us() < die->cache_busy_until_us) {
+    status |= STATUS_BIT_CACHE_READ_BUSY_MASK;
+  }
+
+  return status;
+}
+
+static void emul_power_on(struct mt29f_emul_data *data)
+{
+  data->die = 0;
+  data->pending = false;
+
+  for (int d = 0; d < EMUL_DIES; d++) {
+    mt29f_emul_die_t *die = &data->dies[d];
+
+    die->status = 0;
+    die->config = EMUL_CONFIG_DEFAULT;
+    die->lock = EMUL_LOCK_DEFAULT;
+    die->busy_until_us = 0;
+    die->cache_busy_until_us = 0;
+    die->data_row = -1;
+    memset(die->cache, 0xFF, sizeof(die->cache));
+  }
+}
+
+/*
+ * Copies a page into the cache register and sets the ECC status bits for it
+ */
+static void emul_load_page(struct mt29f_emul_data *data, mt29f_emul_die_t *die, const int32_t row)
+{
+  const uint16_t block = (row >> BLOCK_POS) & 0x7FF;
+  const uint8_t page = (row >> PAGE_POS) & 0x3F;
+  const uint8_t d = die - data->dies;
+
+  die->status &= ~(STATUS_BIT_ECCS0_MASK | STATUS_BIT_ECCS1_MASK | STATUS_BIT_ECCS2_MASK);
+
+  if (row < 0 || block >= EMUL_BLOCKS) {
+    memset(die->cache, 0xFF, sizeof(die->cache));
+    return;
+  }
+
+  const uint8_t *src = array[d][block][page];
+  for (size_t i = 0; i < EMUL_PAGE_BYTES; i++) {
+    die->cache[i] = ~src[i];
+  }
+
+  if (!(die->config & SEC_STATUS_BIT_ECC_EN)) {
+    return;
+  }
+
+  const uint8_t bits = data->bitflips[d][block][page];
+  uint8_t eccs = ECC_STATUS_OK;
+
+  if (bits > 8) {
+    eccs = ECC_STATUS_NOT_OK;
+    // Uncorrectable: the errors make it into the cache register
+    for (uint8_t i = 0; i < bits; i++) {
+      die->cache[(i * 251) % EMUL_PAGE_BYTES] ^= BIT(i % 8);
+    }
+  } else if (bits > 6) {
+    eccs = ECC_STATUS_7_8_R;
+  } else if (bits > 3) {
+    eccs = ECC_STATUS_4_6_R;
+  } else if (bits > 0) {
+    eccs = ECC_STATUS_1_3_NR;
+  }
+
+  die->status |= eccs << 4;
+}
+
+// Counts down an armed power cut, true once the array no longer changes
+static bool emul_power_lost(struct mt29f_emul_data *data)
+{
+  if (!data->power_cut) {
+    return false;
+  }
+  if (data->ops_left == 0) {
+    return true;
+  }
+
+  data->ops_left--;
+  return false;
+}
+
+static void emul_program_execute(struct mt29f_emul_data *data, const uint32_t row)
+{
+  mt29f_emul_die_t *die = emul_die(data);
+  const uint16_t block = (row >> BLOCK_POS) & 0x7FF;
+  const uint8_t page = (row >> PAGE_POS) & 0x3F;
+
+  if (!(die->status & STATUS_BIT_WEL_MASK)) {
+    LOG_WRN("PROGRAM EXECUTE without WEL, ignored");
+    return;
+  }
+
+  die->status &= ~(STATUS_BIT_WEL_MASK | STATUS_BIT_PROGRAM_FAIL_MASK);
+  die->busy_until_us = emul_now_us() + data->t_prog_us;
+
+  if (emul_power_lost(data)) {
+    return;
+  }
+
+  if (block >= EMUL_BLOCKS || data->bad[data->die][block] != BLOCK_GOOD || (die->lock & PROT_STATUS_BP_MASK)) {
+    die->status |= STATUS_BIT_PROGRAM_FAIL_MASK;
+    return;
+  }
+
+  // Pages of a block must be programmed in order, only the newest one may take another partial program
+  if (page + 1 < data->next_page[data->die][block]) {
+    LOG_WRN("Page %d/%d/%d programmed after page %d", data->die, block, page, data->next_page[data->die][block] - 1);
+    die->status |= STATUS_BIT_PROGRAM_FAIL_MASK;
+    return;
+  }
+  data->next_page[data->die][block] = page + 1;
+
+  if (++data->nop[data->die][block][page] > 4) {
+    LOG_WRN("Page %d/%d/%d programmed %d times without erase", data->die, block, page,
+            data->nop[data->die][block][page]);
+  }
+
+  // Programming can only clear bits
+  uint8_t *dst = array[data->die][block][page];
+  for (size_t i = 0; i < EMUL_PAGE_BYTES; i++) {
+    dst[i] |= (uint8_t)~die->cache[i];
+  }
+}
+
+static void emul_mark_factory_bad(const uint8_t d, const uint16_t block)
+{
+  array[d][block][0][EMUL_MAIN_BYTES + OOB_BAD_BLOCK_MARKER_POS] = 0xFF;
+}
+
+static void emul_block_erase(struct mt29f_emul_data *data, const uint32_t row)
+{
+  mt29f_emul_die_t *die = emul_die(data);
+  const uint16_t block = (row >> BLOCK_POS) & 0x7FF;
+
+  if (!(die->status & STATUS_BIT_WEL_MASK)) {
+    LOG_WRN("BLOCK ERASE without WEL, ignored");
+    return;
+  }
+
+  die->status &= ~(STATUS_BIT_WEL_MASK | STATUS_BIT_ERASE_FAIL_MASK);
+  die->busy_until_us = emul_now_us() + data->t_bers_us;
+
+  if (emul_power_lost(data)) {
+    return;
+  }
+
+  if (block >= EMUL_BLOCKS || data->bad[data->die][block] != BLOCK_GOOD || (die->lock & PROT_STATUS_BP_MASK)) {
+    die->status |= STATUS_BIT_ERASE_FAIL_MASK;
+    return;
+  }
+
+  memset(array[data->die][block], 0, sizeof(array[data->die][block]));
+  memset(data->nop[data->die][block], 0, sizeof(data->nop[data->die][block]));
+  data->next_page[data->die][block] = 0;
+  memset(data->bitflips[data->die][block], 0, sizeof(data->bitflips[data->die][block]));
+  data->erase_count[data->die][block]++;
+}
+
+static uint32_t emul_row(const uint8_t *tx)
+{
+  return ((uint32_t)tx[1] << 16) | ((uint32_t)tx[2] << 8) | tx[3];
+}
+
+static void emul_cache_out(mt29f_emul_die_t *die, uint16_t col, uint8_t *rx, const size_t len)
+{
+  col &= 0x0FFF;
+
+  for (size_t i = 0; i < len; i++, col++) {
+    rx[i] = (col < EMUL_PAGE_BYTES) ? die->cache[col] : 0xFF;
+  }
+}
+
+static void emul_cache_in(mt29f_emul_die_t *die, uint16_t col, const uint8_t *tx, const size_t len)
+{
+  col &= 0x0FFF;
+
+  for (size_t i = 0; i < len && col < EMUL_PAGE_BYTES; i++, col++) {
+    die->cache[col] = tx[i];
+  }
+}
+
+static bool emul_is_cache_read(const uint8_t cmd)
+{
+  return cmd == COMMAND_READ_FROM_CACHE_x1 || cmd == COMMAND_READ_FROM_CACHE_x2 ||
+         cmd == COMMAND_READ_FROM_CACHE_x4 || cmd == COMMAND_READ_FROM_CACHE_Dual_IO ||
+         cmd == COMMAND_READ_FROM_CACHE_Quad_IO;
+}
+
+static bool emul_is_program_load(const uint8_t cmd)
+{
+  return cmd == COMMAND_PROGRAM_LOAD_x1 || cmd == COMMAND_PROGRAM_LOAD_x2 ||
+         cmd == COMMAND_PROGRAM_LOAD_x4;
+}
+
+static bool emul_is_program_load_random(const uint8_t cmd)
+{
+  return cmd == COMMAND_PROGRAM_LOAD_RANDOM_DATA_x1 || cmd == COMMAND_PROGRAM_LOAD_RANDOM_DATA_x2 ||
+         cmd == COMMAND_PROGRAM_LOAD_RANDOM_DATA_x4;
+}
+
+/*
+ * Data phase of cache reads and program loads, either right after the command bytes
+ * or as the second transaction of a wide transfer
+ */
+static void emul_data_phase(struct mt29f_emul_data *data, const uint8_t cmd, const uint16_t col,
+                            const uint8_t *tx, uint8_t *rx, const size_t len)
+{
+  mt29f_emul_die_t *die = emul_die(data);
+
+  if (emul_is_cache_read(cmd)) {
+    emul_cache_out(die, col, rx, len);
+  } else {
+    emul_cache_in(die, col, tx, len);
+  }
+}
+
+/*
+ * Runs one chip select cycle worth of bytes
+ */
+static void emul_command(struct mt29f_emul_data *data, const size_t len, const bool hold)
+{
+  const uint8_t *tx = data->tx;
+  uint8_t *rx = data->rx;
+  const uint8_t cmd = tx[0];
+  mt29f_emul_die_t *die = emul_die(data);
+
+  // While busy only status reads and RESET are accepted
+  if (emul_die_busy(die) && cmd != COMMAND_GET_FEATURE && cmd != COMMAND_RESET &&
+      !(cmd == COMMAND_SET_FEATURE && tx[1] == REG_DIE_SELECT)) {
+    LOG_WRN("Command %02X while die %d busy, ignored", cmd, data->die);
+    return;
+  }
+
+  if (emul_is_cache_read(cmd) || emul_is_program_load(cmd) || emul_is_program_load_random(cmd)) {
+    const size_t hdr = (cmd == COMMAND_READ_FROM_CACHE_Quad_IO) ? 5 : emul_is_cache_read(cmd) ? 4 : 3;
+    const uint16_t col = ((uint16_t)tx[1] << 8) | tx[2];
+
+    if (emul_is_program_load(cmd)) {
+      memset(die->cache, 0xFF, sizeof(die->cache));
+    }
+
+    if (len <= hdr) {
+      if (hold) {
+        data->pending = true;
+        data->pending_cmd = cmd;
+        data->pending_col = col;
+      }
+      return;
+    }
+
+    emul_data_phase(data, cmd, col, &tx[hdr], &rx[hdr], len - hdr);
+    return;
+  }
+
+  switch (cmd) {
+    case COMMAND_RESET:
+      emul_power_on(data);
+      for (int d = 0; d < EMUL_DIES; d++) {
+        data->dies[d].busy_until_us = emul_now_us() + EMUL_T_RST_US;
+      }
+      break;
+
+    case COMMAND_GET_FEATURE:
+      if (len < 3) {
+        break;
+      }
+      switch (tx[1]) {
+        case REG_BLOCK_LOCK:
+          rx[2] = die->lock;
+          break;
+        case REG_CONFIGURATION:
+          rx[2] = die->config;
+          break;
+        case REG_STATUS:
+          rx[2] = emul_status(die);
+          break;
+        case REG_DIE_SELECT:
+          rx[2] = (data->die == 0) ? DIE_0 : DIE_1;
+          break;
+        default:
+          rx[2] = 0;
+          break;
+      }
+      break;
+
+    case COMMAND_SET_FEATURE:
+      if (len < 3) {
+        break;
+      }
+      switch (tx[1]) {
+        case REG_BLOCK_LOCK:
+          die->lock = tx[2];
+          break;
+        case REG_CONFIGURATION:
+          die->config = tx[2];
+          break;
+        case REG_DIE_SELECT:
+          data->die = (tx[2] & DIE_1) ? 1 : 0;
+          break;
+        default:
+          break;
+      }
+      break;
+
+    case COMMAND_READ_ID:
+      if (len >= 4) {
+        rx[2] = MANUFACTURER_ID;
+        rx[3] = DEVICE_ID;
+      }
+      break;
+
+    case COMMAND_WRITE_ENABLE:
+      die->status |= STATUS_BIT_WEL_MASK;
+      break;
+
+    case COMMAND_WRITE_DISABLE:
+      die->status &= ~STATUS_BIT_WEL_MASK;
+      break;
+
+    case COMMAND_PAGE_READ:
+      emul_load_page(data, die, emul_row(tx));
+      die->data_row = emul_row(tx);
+      die->busy_until_us = emul_now_us() + data->t_r_us;
+      break;
+
+    case COMMAND_READ_PAGE_CACHE_RANDOM:
+      // The data register moves to the cache while the next page loads behind it
+      emul_load_page(data, die, die->data_row);
+      die->data_row = emul_row(tx);
+      die->busy_until_us = emul_now_us() + EMUL_T_RCBSY_US;
+      die->cache_busy_until_us = emul_now_us() + data->t_r_us;
+      break;
+
+    case COMMAND_READ_PAGE_CACHE_LAST:
+      emul_load_page(data, die, die->data_row);
+      die->data_row = -1;
+      die->busy_until_us = emul_now_us() + EMUL_T_RCBSY_US;
+      break;
+
+    case COMMAND_PROGRAM_EXECUTE:
+      emul_program_execute(data, emul_row(tx));
+      break;
+
+    case COMMAND_BLOCK_ERASE:
+      emul_block_erase(data, emul_row(tx));
+      break;
+
+    default:
+      LOG_WRN("Unsupported command %02X", cmd);
+      break;
+  }
+}
+
+static size_t emul_gather(const struct spi_buf_set *set, uint8_t *dst, const size_t max)
+{
+  size_t len = 0;
+
+  for (size_t i = 0; set && i < set->count; i++) {
+    const struct spi_buf *buf = &set->buffers[i];
+    const size_t n = MIN(buf->len, max - len);
+
+    if (buf->buf) {
+      memcpy(&dst[len], buf->buf, n);
+    } else {
+      memset(&dst[len], 0, n);
+    }
+    len += n;
+  }
+
+  return len;
+}
+
+static size_t emul_buf_set_len(const struct spi_buf_set *set)
+{
+  size_t len = 0;
+
+  for (size_t i = 0; set && i < set->count; i++) {
+    len += set->buffers[i].len;
+  }
+
+  return len;
+}
+
+static void emul_scatter(const struct spi_buf_set *set, const uint8_t *src)
+{
+  size_t pos = 0;
+
+  for (size_t i = 0; set && i < set->count; i++) {
+    const struct spi_buf *buf = &set->buffers[i];
+
+    if (buf->buf) {
+      memcpy(buf->buf, &src[pos], buf->len);
+    }
+    pos += buf->len;
+  }
+}
+
+static uint8_t emul_lines(const struct spi_config *config)
+{
+  switch (config->operation & SPI_LINES_MASK) {
+    case SPI_LINES_DUAL:
+      return 2;
+    case SPI_LINES_QUAD:
+      return 4;
+    case SPI_LINES_OCTAL:
+      return 8;
+    default:
+      return 1;
+  }
+}
+
+static int mt29f_emul_io(const struct emul *target, const struct spi_config *config,
+                         const struct spi_buf_set *tx_bufs, const struct spi_buf_set *rx_bufs)
+{
+  struct mt29f_emul_data *data = target->data;
+  const uint8_t lines = emul_lines(config);
+
+  if (lines > data->max_lines) {
+    return -ENOTSUP;
+  }
+
+  const size_t len = MAX(emul_buf_set_len(tx_bufs), emul_buf_set_len(rx_bufs));
+  if (len == 0 || len > EMUL_MAX_XFER) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  memset(data->tx, 0, len);
+  memset(data->rx, 0, len);
+  emul_gather(tx_bufs, data->tx, len);
+
+  if (data->pending) {
+    data->pending = false;
+    emul_data_phase(data, data->pending_cmd, data->pending_col, data->tx, data->rx, len);
+  } else {
+    emul_command(data, len, (config->operation & SPI_HOLD_ON_CS) != 0);
+  }
+
+  emul_scatter(rx_bufs, data->rx);
+
+  k_spin_unlock(&data->lock, key);
+
+  // Bus time, this is also what lets simulated time pass while the driver polls OIP
+  const uint32_t freq = config->frequency ? config->frequency : MHZ(1);
+  k_busy_wait(MAX(1, (uint32_t)(((uint64_t)len * 8 * USEC_PER_SEC) / ((uint64_t)freq * lines))));
+
+  return 0;
+}
+
+static struct spi_emul_api mt29f_emul_api = {
+  .io = mt29f_emul_io,
+};
+
+
+/**
+ * --------------------------------------------------------
+ * Public API
+ * --------------------------------------------------------
+*/
+void mt29f_emul_set_timing(const struct emul *target, uint32_t t_r_us, uint32_t t_prog_us, uint32_t t_bers_us)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  data->t_r_us = t_r_us;
+  data->t_prog_us = t_prog_us;
+  data->t_bers_us = t_bers_us;
+}
+
+void mt29f_emul_set_max_lines(const struct emul *target, uint8_t lines)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  data->max_lines = lines;
+}
+
+void mt29f_emul_set_bad_block(const struct emul *target, uint8_t die, uint16_t block, bool factory)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  if (die >= EMUL_DIES || block >= EMUL_BLOCKS) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+  data->bad[die][block] = factory ? BLOCK_FACTORY_BAD : BLOCK_GROWN_BAD;
+  if (factory) {
+    emul_mark_factory_bad(die, block);
+  }
+  k_spin_unlock(&data->lock, key);
+}
+
+void mt29f_emul_set_bitflips(const struct emul *target, uint8_t die, uint16_t block, uint8_t page, uint8_t bits)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  if (die >= EMUL_DIES || block >= EMUL_BLOCKS || page >= EMUL_PAGES) {
+    return;
+  }
+
+  data->bitflips[die][block][page] = bits;
+}
+
+void mt29f_emul_set_power_cut(const struct emul *target, bool enable, uint32_t ops)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+  data->power_cut = enable;
+  data->ops_left = ops;
+  k_spin_unlock(&data->lock, key);
+}
+
+uint32_t mt29f_emul_get_erase_count(const struct emul *target, uint8_t die, uint16_t block)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  if (die >= EMUL_DIES || block >= EMUL_BLOCKS) {
+    return 0;
+  }
+
+  return data->erase_count[die][block];
+}
+
+void mt29f_emul_reset(const struct emul *target)
+{
+  struct mt29f_emul_data *data = target->data;
+
+  k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+  memset(array, 0, sizeof(array));
+  memset(data->bad, 0, sizeof(data->bad));
+  memset(data->nop, 0, sizeof(data->nop));
+  memset(data->next_page, 0, sizeof(data->next_page));
+  memset(data->bitflips, 0, sizeof(data->bitflips));
+  memset(data->erase_count, 0, sizeof(data->erase_count));
+  data->power_cut = false;
+  emul_power_on(data);
+
+  k_spin_unlock(&data->lock, key);
+}
+
+static int mt29f_emul_init(const struct emul *target, const struct device *parent)
+{
+  ARG_UNUSED(parent);
+
+  struct mt29f_emul_data *data = target->data;
+
+  data->t_r_us = MT29F_EMUL_T_R_US;
+  data->t_prog_us = MT29F_EMUL_T_PROG_US;
+  data->t_bers_us = MT29F_EMUL_T_BERS_US;
+  data->max_lines = 4;
+
+  emul_power_on(data);
+
+  return 0;
+}
+
+#define MT29F_EMUL_DEFINE(n)                                              \
+  static struct mt29f_emul_data mt29f_emul_data_##n;                      \
+  EMUL_DT_INST_DEFINE(n, mt29f_emul_init, &mt29f_emul_data_##n, NULL,     \
+                      &mt29f_emul_api, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(MT29F_EMUL_DEFINE)
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/drivers/emul.h>
+
+/**
+ * Host-side model of the MT29F SPI NAND for native_sim builds. It sits behind a
+ * `zephyr,spi-emul-controller` node so the driver runs unmodified on top of it.
+*/
+
+// Datasheet typicals, used until mt29f_emul_set_timing() is called
+#define MT29F_EMUL_T_R_US      25
+#define MT29F_EMUL_T_PROG_US   200
+#define MT29F_EMUL_T_BERS_US   2000
+
+/**
+ * @brief Array timings modelled through the OIP bit of the status register
+*/
+void mt29f_emul_set_timing(const struct emul *target, uint32_t t_r_us, uint32_t t_prog_us, uint32_t t_bers_us);
+
+/**
+ * @brief Widest bus mode the emulated controller accepts (1, 2 or 4), wider transfers fail with -ENOTSUP
+*/
+void mt29f_emul_set_max_lines(const struct emul *target, uint8_t lines);
+
+/**
+ * @brief Marks a physical block bad
+ *
+ * @param factory   also clears the bad block marker in the spare area of page 0,
+ *                  otherwise the block only starts failing erase and program (grown bad block)
+*/
+void mt29f_emul_set_bad_block(const struct emul *target, uint8_t die, uint16_t block, bool factory);
+
+/**
+ * @brief Bit errors the on-die ECC will see on a page until its block is erased
+ *
+ * @desc 1-3 report "corrected", 4-8 "refresh recommended", more than 8 "uncorrectable"
+*/
+void mt29f_emul_set_bitflips(const struct emul *target, uint8_t die, uint16_t block, uint8_t page, uint8_t bits);
+
+/**
+ * @brief Cuts the supply after `ops` more program or erase operations
+ *
+ * @desc The array keeps its contents but ignores every later program and erase while the
+ *       driver sees them succeed, until the cut is disabled again (power restored).
+*/
+void mt29f_emul_set_power_cut(const struct emul *target, bool enable, uint32_t ops);
+
+/**
+ * @brief Number of times a physical block was erased
+*/
+uint32_t mt29f_emul_get_erase_count(const struct emul *target, uint8_t die, uint16_t block);
+
+/**
+ * @brief Clears all data, bad blocks and counters (power cycle into a fresh chip)
+*/
+void mt29f_emul_reset(const struct emul *target);
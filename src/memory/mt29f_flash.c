@@ -0,0 +1,318 @@
+//*****************************************************************************
+//!
+//! @file mt29f_flash.c
+//! @author Anders Bandt
+//! @brief Zephyr flash device on top of the MT29F driver
+//! @version 0.9
+//! @date October 2026
+//!
+//! Exposes the main areas of the logical blocks as one flat flash device, so
+//! flash_map partitions, stream_flash and the flash shell work on the chip. The
+//! spare areas stay with the driver (bad block markers, ECC, OOB metadata), which
+//! makes a 2 KiB page the write block and a 128 KiB block the erase page. Reads go
+//! through the cache-read path, writes are loaded straight from the caller's buffer.
+//!
+//! The `ftl_partition` at the start of the chip belongs to the FTL under the NVS
+//! log, so any access below its end is refused. Offsets stay chip absolute, which
+//! keeps the other fixed partitions valid flash_map areas.
+//!
+//! NAND pages of a block must be programmed in order, so every block keeps a
+//! program high-water mark and writes below it fail with -EINVAL. The mark is
+//! reset by an erase; after a boot it is found on the first write to the block.
+//!
+//*****************************************************************************
+
+#define DT_DRV_COMPAT micron_mt29f
+
+/* Standard C99 stuff */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* Zephyr files */
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+/* My header files  */
+#include "mt29f_nand.h"
+#include "ftl.h"
+
+
+LOG_MODULE_REGISTER(mt29f_flash, LOG_LEVEL_INF);
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) == 1, "The MT29F driver supports exactly one chip");
+BUILD_ASSERT(FTL_PARTITION_BYTES > 0, "The flash device needs an ftl_partition to keep away from");
+
+
+#define MAIN_BYTES  DT_INST_PROP(0, page_size)
+
+// After the SPI controller (CONFIG_SPI_INIT_PRIORITY, 70 by default)
+#define MT29F_FLASH_INIT_PRIORITY  80
+
+// Blocks handed to one mt29f_erase_blocks() call, so both dies erase at once
+#define ERASE_BATCH  16
+
+// Blocks after the FTL partition, the only ones the device touches
+#define BLOCK_MAIN_BYTES  (DT_INST_PROP(0, pages_per_block) * MAIN_BYTES)
+#define FIRST_BLOCK       (FTL_PARTITION_BYTES / BLOCK_MAIN_BYTES)
+#define MAX_BLOCKS        (DT_INST_PROP(0, dies) * DT_INST_PROP(0, blocks_per_die) - FIRST_BLOCK)
+
+// High-water mark of a block that was not written or erased since boot
+#define PAGE_UNKNOWN  0xFF
+
+// Bytes compared per read when looking for the first erased page of a block
+#define PROBE_BYTES  256
+
+BUILD_ASSERT(DT_INST_PROP(0, pages_per_block) < PAGE_UNKNOWN, "Page numbers must fit the high-water marks");
+
+static const mt29f_cfg_t cfg = {
+  .num_dies = DT_INST_PROP(0, dies),
+  .blocks_per_die = DT_INST_PROP(0, blocks_per_die),
+  .pages_per_block = DT_INST_PROP(0, pages_per_block),
+  .bytes_per_page = DT_INST_PROP(0, page_size) + DT_INST_PROP(0, spare_size),
+  .oob_bytes = DT_INST_PROP(0, spare_size)
+};
+
+// NAND pages take one program each, so a page is the smallest write
+static const struct flash_parameters flash_params = {
+  .write_block_size = MAIN_BYTES,
+  .erase_value = 0xFF
+};
+
+static struct flash_pages_layout layout;
+static off_t flash_size = 0;
+
+// Next page each block may program, PAGE_UNKNOWN until erased or probed
+static uint8_t next_page[MAX_BLOCKS];
+static K_MUTEX_DEFINE(flash_lock);
+
+
+/**
+ * --------------------------------------------------------
+ * Local functions
+ * --------------------------------------------------------
+*/
+
+static uint32_t mt29f_flash_block_bytes(void)
+{
+  return (uint32_t)cfg.pages_per_block * MAIN_BYTES;
+}
+
+/*
+ * Flash offsets skip the spare areas, driver offsets do not
+ */
+static off_t mt29f_flash_to_nand(const off_t offset)
+{
+  return (offset / MAIN_BYTES) * cfg.bytes_per_page + offset % MAIN_BYTES;
+}
+
+static bool mt29f_flash_in_range(const off_t offset, const size_t len)
+{
+  return offset >= FTL_PARTITION_BYTES && (uint64_t)offset + len <= (uint64_t)flash_size;
+}
+
+/*
+ * A page reads back all 0xFF until it is programmed
+ */
+static int mt29f_flash_page_is_erased(const uint32_t block, const uint32_t page, bool *erased)
+{
+  const off_t start = (off_t)block * mt29f_flash_block_bytes() + (off_t)page * MAIN_BYTES;
+  uint8_t probe[PROBE_BYTES];
+
+  *erased = false;
+  for (uint32_t done = 0; done < MAIN_BYTES; done += PROBE_BYTES) {
+    int rc = mt29f_read_main(mt29f_flash_to_nand(start + done), probe, PROBE_BYTES);
+    if (rc < 0) {
+      return rc;
+    }
+
+    for (size_t i = 0; i < PROBE_BYTES; i++) {
+      if (probe[i] != 0xFF) {
+        return 0;
+      }
+    }
+  }
+
+  *erased = true;
+  return 0;
+}
+
+/*
+ * Writes may skip pages, so the mark is one past the highest programmed page. Only the
+ * erased pages above it have to be read in full.
+ */
+static int mt29f_flash_next_page(const uint32_t block, uint8_t *next)
+{
+  uint8_t *mark = &next_page[block - FIRST_BLOCK];
+
+  if (*mark == PAGE_UNKNOWN) {
+    uint32_t page = cfg.pages_per_block;
+
+    while (page > 0) {
+      bool erased;
+
+      int rc = mt29f_flash_page_is_erased(block, page - 1, &erased);
+      if (rc != 0) {
+        return rc;
+      }
+
+      if (!erased) {
+        break;
+      }
+      page--;
+    }
+    *mark = page;
+  }
+
+  *next = *mark;
+  return 0;
+}
+
+static int mt29f_flash_read(const struct device *dev, off_t offset, void *data, size_t len)
+{
+  ARG_UNUSED(dev);
+
+  if (!mt29f_flash_in_range(offset, len)) {
+    return -EINVAL;
+  }
+
+  // Corrected bit flips are the driver's business (refresh queue), only errors go up
+  int rc = mt29f_read_main(mt29f_flash_to_nand(offset), data, len);
+
+  return (rc < 0) ? rc : 0;
+}
+
+static int mt29f_flash_write(const struct device *dev, off_t offset, const void *data, size_t len)
+{
+  ARG_UNUSED(dev);
+
+  if (!mt29f_flash_in_range(offset, len) || offset % MAIN_BYTES != 0 || len % MAIN_BYTES != 0) {
+    return -EINVAL;
+  }
+
+  const uint32_t block_bytes = mt29f_flash_block_bytes();
+  const off_t end = offset + len;
+  int rc = 0;
+
+  k_mutex_lock(&flash_lock, K_FOREVER);
+
+  // Check every block before the first program, so a rejected write changes nothing
+  for (off_t pos = offset; pos < end && rc == 0; pos = (pos / block_bytes + 1) * block_bytes) {
+    uint8_t next;
+
+    rc = mt29f_flash_next_page(pos / block_bytes, &next);
+    if (rc == 0 && (pos % block_bytes) / MAIN_BYTES < next) {
+      LOG_ERR("Write at 0x%lx below the program high-water mark of its block", (long)pos);
+      rc = -EINVAL;
+    }
+  }
+
+  if (rc != 0) {
+    goto out;
+  }
+
+  rc = mt29f_program_main(mt29f_flash_to_nand(offset), data, len);
+
+  // A failed program may have stopped anywhere, so probe the blocks again next time
+  for (off_t pos = offset; pos < end; pos = (pos / block_bytes + 1) * block_bytes) {
+    const off_t last = MIN(end, (pos / block_bytes + 1) * block_bytes) - MAIN_BYTES;
+
+    next_page[pos / block_bytes - FIRST_BLOCK] = (rc == 0) ? (last % block_bytes) / MAIN_BYTES + 1 : PAGE_UNKNOWN;
+  }
+
+out:
+  k_mutex_unlock(&flash_lock);
+
+  return rc;
+}
+
+static int mt29f_flash_erase(const struct device *dev, off_t offset, size_t size)
+{
+  ARG_UNUSED(dev);
+
+  const uint32_t block_bytes = mt29f_flash_block_bytes();
+  uint32_t blocks[ERASE_BATCH];
+
+  if (!mt29f_flash_in_range(offset, size) || offset % block_bytes != 0 || size % block_bytes != 0) {
+    return -EINVAL;
+  }
+
+  uint32_t block = offset / block_bytes;
+  const uint32_t end = block + size / block_bytes;
+  int rc = 0;
+
+  k_mutex_lock(&flash_lock, K_FOREVER);
+
+  while (block < end && rc == 0) {
+    size_t count = 0;
+    while (count < ERASE_BATCH && block < end) {
+      blocks[count++] = block++;
+    }
+
+    rc = mt29f_erase_blocks(blocks, count);
+
+    for (size_t i = 0; i < count; i++) {
+      next_page[blocks[i] - FIRST_BLOCK] = (rc == 0) ? 0 : PAGE_UNKNOWN;
+    }
+  }
+
+  k_mutex_unlock(&flash_lock);
+
+  return rc;
+}
+
+static const struct flash_parameters *mt29f_flash_get_parameters(const struct device *dev)
+{
+  ARG_UNUSED(dev);
+
+  return &flash_params;
+}
+
+#if defined(CONFIG_FLASH_PAGE_LAYOUT)
+static void mt29f_flash_page_layout(const struct device *dev, const struct flash_pages_layout **out,
+                                    size_t *out_size)
+{
+  ARG_UNUSED(dev);
+
+  *out = &layout;
+  *out_size = 1;
+}
+#endif
+
+static int mt29f_flash_init(const struct device *dev)
+{
+  ARG_UNUSED(dev);
+
+  if (!mt29f_is_ready()) {
+    mt29f_init(&cfg);
+  }
+
+  memset(next_page, PAGE_UNKNOWN, sizeof(next_page));
+
+  // The reserved spare and BBT blocks are not part of the device
+  layout.pages_count = mt29f_get_num_blocks();
+  layout.pages_size = mt29f_flash_block_bytes();
+  flash_size = (off_t)layout.pages_count * layout.pages_size;
+
+  LOG_INF("Flash device: %d erase pages of %d bytes, first %d bytes kept for the FTL", layout.pages_count,
+          layout.pages_size, (int)FTL_PARTITION_BYTES);
+
+  return 0;
+}
+
+static const struct flash_driver_api mt29f_flash_api = {
+  .read = mt29f_flash_read,
+  .write = mt29f_flash_write,
+  .erase = mt29f_flash_erase,
+  .get_parameters = mt29f_flash_get_parameters,
+#if defined(CONFIG_FLASH_PAGE_LAYOUT)
+  .page_layout = mt29f_flash_page_layout,
+#endif
+};
+
+DEVICE_DT_INST_DEFINE(0, mt29f_flash_init, NULL, NULL, NULL, POST_KERNEL, MT29F_FLASH_INIT_PRIORITY,
+                      &mt29f_flash_api);
@@ -23,6 +23,7 @@
 #include <zephyr/drivers/spi.h>
 #include <zephyr/kernel.h>
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/logging/log.h>
 
 
@@ -42,10 +43,30 @@ LOG_MODULE_REGISTER(mt29f_nand, LOG_LEVEL_INF);
 #define DT_DRV_COMPAT nordic_nrf_spim
 
 #define SPI_DEV DT_COMPAT_GET_ANY_STATUS_OKAY(micron_mt29f)
-#define SPI_OP SPI_OP_MODE_MASTER | SPI_MODE_CPOL | SPI_MODE_CPHA | SPI_WORD_SET(8) | SPI_LINES_SINGLE
+#define SPI_OP_BASE SPI_OP_MODE_MASTER | SPI_MODE_CPOL | SPI_MODE_CPHA | SPI_WORD_SET(8)
+#define SPI_OP SPI_OP_BASE | SPI_LINES_SINGLE
 
 static struct spi_dt_spec spi_dev = SPI_DT_SPEC_GET(SPI_DEV, SPI_OP, 0);
 
+// Bus width for the data phase of cache reads and program loads, from devicetree
+#define MT29F_DT_BUS_WIDTH  DT_PROP_OR(SPI_DEV, bus_width, 1)
+
+// Enabled devices on the SPI bus of the NAND
+#define MT29F_DT_BUS_DEV(node)  + 1
+#define MT29F_DT_BUS_DEVICES    (0 DT_FOREACH_CHILD_STATUS_OKAY(DT_BUS(SPI_DEV), MT29F_DT_BUS_DEV))
+
+// Wide transfers: opcode, address and dummy byte always go out on one line with CS
+// held, then the data phase runs on 2 or 4 lines. The bus lock (SPI_LOCK_ON) belongs
+// to a single spi_config and cannot span the switch to the wide one, so another device
+// could take the bus between the phases. Wide modes are only used when the NAND has
+// the bus to itself.
+static struct spi_dt_spec spi_dev_hold = SPI_DT_SPEC_GET(SPI_DEV, SPI_OP | SPI_HOLD_ON_CS, 0);
+static struct spi_dt_spec spi_dev_x2 = SPI_DT_SPEC_GET(SPI_DEV, SPI_OP_BASE | SPI_LINES_DUAL, 0);
+static struct spi_dt_spec spi_dev_x4 = SPI_DT_SPEC_GET(SPI_DEV, SPI_OP_BASE | SPI_LINES_QUAD, 0);
+
+// Bus width actually in use, the widest one the controller accepted at init
+static uint8_t bus_width = 1;
+
 typedef struct mt29f_row_addr {
   uint8_t   die_num;
   uint8_t   page_num;
@@ -56,6 +77,141 @@ typedef uint16_t mt29f_col_addr_t;
 
 static mt29f_cfg_t inst = {0};
 
+// Serializes SPI access between callers and the background erase worker
+static K_MUTEX_DEFINE(nand_lock);
+
+// Blocks that are known to be erased and not yet programmed (1 bit per physical block)
+#define MAX_SUPPORTED_BLOCKS  (2 * 1024)
+static uint32_t erased_blocks[MAX_SUPPORTED_BLOCKS / 32];
+
+// The top of every die is kept out of the logical address space: it holds the
+// replacement blocks for bad blocks, and on die 0 the two bad block table copies.
+#define RESERVED_BLOCKS_PER_DIE  24
+#define BBT_COPIES               2
+#define BBT_MAGIC                0x31544242  // "BBT1"
+#define MAX_REMAP_ENTRIES        (2 * RESERVED_BLOCKS_PER_DIE)
+
+typedef struct mt29f_remap {
+  uint16_t  logical;    // global logical block
+  uint16_t  physical;   // block number on the same die
+} mt29f_remap_t;
+
+// Bad block table, persisted to page 0 of the BBT blocks
+typedef struct mt29f_bbt {
+  uint32_t       magic;
+  uint32_t       seq;
+  uint16_t       num_remap;
+  uint16_t       reserved;
+  mt29f_remap_t  remap[MAX_REMAP_ENTRIES];
+  uint32_t       bad[MAX_SUPPORTED_BLOCKS / 32];   // 1 bit per physical block
+  uint32_t       crc;
+} __packed mt29f_bbt_t;
+
+static mt29f_bbt_t bbt;
+
+// Blocks queued for erase by mt29f_erase_block_async()
+#define ERASE_QUEUE_LEN  8
+static uint16_t erase_queue[ERASE_QUEUE_LEN];
+static uint8_t erase_queue_count = 0;
+
+// Logical blocks that reported a refresh-recommended ECC status
+#define REFRESH_QUEUE_LEN  8
+static uint16_t refresh_queue[REFRESH_QUEUE_LEN];
+static uint8_t refresh_queue_count = 0;
+
+// Extra page loads before a read is reported as uncorrectable
+#define READ_RETRIES          3
+// Uncorrectable pages of one cache-read run that get retried individually
+#define READ_RETRY_MAX_PAGES  4
+
+// Blocks collected by mt29f_chip_erase() before one interleaved erase pass
+#define CHIP_ERASE_BATCH  32
+
+// Background erase work queue, also runs the operations of mt29f_submit()
+#define ERASE_WORKQ_STACK_SIZE    1024
+#define ERASE_WORKQ_PRIORITY      K_LOWEST_APPLICATION_THREAD_PRIO
+
+K_THREAD_STACK_DEFINE(erase_workq_stack, ERASE_WORKQ_STACK_SIZE);
+static struct k_work_q erase_workq;
+static struct k_work erase_work;
+static bool erase_workq_started = false;
+
+// Set once mt29f_init() got the chip up
+static bool chip_ready = false;
+
+/*
+ * Status poll schedule of an array operation: the first GET FEATURE goes out after the
+ * datasheet typical time, then one every `poll_us`. Still busy `timeout_us` after the
+ * command (twice the datasheet maximum) counts as a hung chip.
+ */
+typedef struct spi_nand_timing {
+  uint32_t  typ_us;
+  uint32_t  poll_us;
+  uint32_t  timeout_us;
+} spi_nand_timing_t;
+
+static const spi_nand_timing_t timing_read       = { 25, 5, 2 * 70 };           // tR with ECC
+static const spi_nand_timing_t timing_cache_read = { 3, 2, 2 * 25 };            // tRCBSY
+static const spi_nand_timing_t timing_program    = { 200, 25, 2 * 600 };        // tPROG
+static const spi_nand_timing_t timing_erase      = { 2000, 250, 2 * 10000 };    // tBERS
+static const spi_nand_timing_t timing_reset      = { 1250, 100, 2 * 1250 };     // tPOR
+
+// Shorter waits are busy-waited, a sleep would round up to the next tick and cost
+// two context switches on top
+#define POLL_SLEEP_MIN_US  100
+
+// The poll clock counts kernel ticks (30.5 us on the nRF52 RTC), coarser than the read
+// timeouts. A timeout only counts once the clock is past it by more than its own step.
+#define POLL_CLOCK_SLACK_US  (2 * k_ticks_to_us_ceil32(1))
+
+// Shadow copy of the chip state, so commands that would not change anything are skipped
+#define MAX_SUPPORTED_DIES  2
+#define SHADOW_UNKNOWN      0xFFFF
+
+static struct {
+  int8_t    die;                          // selected die, -1 if unknown
+  bool      wel;                          // write enable latch
+  uint16_t  lock[MAX_SUPPORTED_DIES];     // block lock register, SHADOW_UNKNOWN if unknown
+  uint16_t  config[MAX_SUPPORTED_DIES];   // configuration register, SHADOW_UNKNOWN if unknown
+} chip;
+
+static mt29f_stats_t stats;
+
+// Erase still running on a die. Commands for that die settle it first, the other die
+// stays usable meanwhile.
+static struct {
+  bool      erasing;
+  uint32_t  block;        // physical block index being erased
+  uint32_t  start_us;     // when BLOCK ERASE went out, see spi_nand_now_us()
+  int       result;       // outcome of the last erase finished on the die
+} die_op[MAX_SUPPORTED_DIES];
+
+static void spi_nand_shadow_invalidate(void)
+{
+  chip.die = -1;
+  chip.wel = false;
+  for (int i = 0; i < MAX_SUPPORTED_DIES; i++) {
+    chip.lock[i] = SHADOW_UNKNOWN;
+    chip.config[i] = SHADOW_UNKNOWN;
+  }
+}
+
+/*
+ * Every call below is one chip select cycle, i.e. one command on the bus
+ */
+static int spi_nand_write(const struct spi_dt_spec *spec, const struct spi_buf_set *tx)
+{
+  stats.spi_transactions++;
+  return spi_write_dt(spec, tx);
+}
+
+static int spi_nand_transceive(const struct spi_dt_spec *spec, const struct spi_buf_set *tx,
+                               const struct spi_buf_set *rx)
+{
+  stats.spi_transactions++;
+  return spi_transceive_dt(spec, tx, rx);
+}
+
 
 static int spi_nand_get_feature(const uint8_t addr, uint8_t *val)
 {
@@ -82,7 +238,7 @@ static int spi_nand_get_feature(const uint8_t addr, uint8_t *val)
     .count = 2,
 	};
 
-  return spi_transceive_dt(&spi_dev, &tx_set, &rx_set);
+  return spi_nand_transceive(&spi_dev, &tx_set, &rx_set);
 }
 
 static int spi_nand_set_feature(const uint8_t addr, const uint8_t val)
@@ -101,7 +257,7 @@ static int spi_nand_set_feature(const uint8_t addr, const uint8_t val)
     .count = 1,
 	};
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  return spi_nand_write(&spi_dev, &tx_set);
 }
 
 static int spi_nand_check_id(void)
@@ -132,7 +288,7 @@ static int spi_nand_check_id(void)
     .count = 2,
 	};
 
-  int ret = spi_transceive_dt(&spi_dev, &tx_set, &rx_set);
+  int ret = spi_nand_transceive(&spi_dev, &tx_set, &rx_set);
 
   if (memcmp(expected, read_id, ARRAY_SIZE(read_id)) != 0) {
     LOG_ERR("Wrong ID: %02X %02X , expected: %02X %02X",
@@ -142,27 +298,185 @@ static int spi_nand_check_id(void)
   return ret;
 }
 
-static int spi_nand_die_select(uint8_t die_num)
+static bool spi_nand_block_is_erased(const uint32_t block)
 {
-  int rc = 0;
-  const uint8_t target_die = (die_num == 0) ? DIE_0 : DIE_1;
-  uint8_t die;
-  spi_nand_get_feature(REG_DIE_SELECT, &die);
-  if (die != target_die) {
-    rc = spi_nand_set_feature(REG_DIE_SELECT, target_die);
-    if (rc != 0) {
-      LOG_ERR("Fail to select Die: %d", rc);
+  return (erased_blocks[block / 32] & BIT(block % 32)) != 0;
+}
+
+static void spi_nand_erase_queue_drop(const uint32_t block);
+
+static void spi_nand_block_mark_erased(const uint32_t block, const bool erased)
+{
+  if (erased) {
+    erased_blocks[block / 32] |= BIT(block % 32);
+  } else {
+    erased_blocks[block / 32] &= ~BIT(block % 32);
+    // The block holds new data now, a queued background erase would destroy it
+    spi_nand_erase_queue_drop(block);
+  }
+}
+
+static uint32_t spi_nand_now_us(void)
+{
+  return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static void spi_nand_delay_us(const uint32_t us)
+{
+  if (us >= POLL_SLEEP_MIN_US) {
+    k_usleep(us);
+  } else {
+    k_busy_wait(us);
+  }
+}
+
+/*
+ * Waits for OIP to clear on the selected die following the poll schedule `t`, counted
+ * from `start_us` (taken right before the command). Sleeping between the polls leaves
+ * the CPU and the SPI controller to other threads. With `wait` false the status is read
+ * once and -EBUSY returned while the operation still runs.
+ */
+static int spi_nand_wait_status(const spi_nand_timing_t *t, const uint32_t start_us, const bool wait,
+                                uint8_t *status)
+{
+  int ret;
+  uint8_t reg = 0;
+  const uint32_t deadline_us = t->timeout_us + POLL_CLOCK_SLACK_US;
+
+  uint32_t elapsed = spi_nand_now_us() - start_us;
+  if (wait && elapsed < t->typ_us) {
+    spi_nand_delay_us(t->typ_us - elapsed);
+  }
+
+  for (;;) {
+    stats.status_polls++;
+    ret = spi_nand_get_feature(REG_STATUS, &reg);
+    if (ret != 0 || !(reg & STATUS_BIT_OIP_MASK)) {
+      break;
     }
+
+    elapsed = spi_nand_now_us() - start_us;
+    if (elapsed >= deadline_us) {
+      LOG_ERR("Die %d still busy after %d us", chip.die, elapsed);
+      return -ETIMEDOUT;
+    }
+    if (!wait) {
+      return -EBUSY;
+    }
+
+    spi_nand_delay_us(MIN(t->poll_us, deadline_us - elapsed));
+  }
+
+  // Free resync of the shadow WEL
+  if (ret == 0) {
+    chip.wel = (reg & STATUS_BIT_WEL_MASK) != 0;
+  }
+
+  *status = reg;
+  return ret;
+}
+
+static int spi_nand_die_switch(uint8_t die_num)
+{
+  if (chip.die == die_num) {
+    stats.skipped_cmds++;
+    return 0;
+  }
+
+  const uint8_t target_die = (die_num == 0) ? DIE_0 : DIE_1;
+  int rc = spi_nand_set_feature(REG_DIE_SELECT, target_die);
+  if (rc != 0) {
+    LOG_ERR("Fail to select Die: %d", rc);
+    chip.die = -1;
+    return rc;
   }
 
+  // Status and WEL are per die
+  chip.die = die_num;
+  chip.wel = false;
+
   LOG_DBG("Die select: %d", die_num);
 
   return rc;
 }
 
+/*
+ * Finishes the erase running on `die`: polls its status until OIP clears, or only once
+ * when `wait` is false (-EBUSY while still running). Leaves `die` selected.
+ */
+static int spi_nand_die_settle(const uint8_t die, const bool wait)
+{
+  if (!die_op[die].erasing) {
+    return 0;
+  }
+
+  int rc = spi_nand_die_switch(die);
+  if (rc != 0) {
+    return rc;
+  }
+
+  uint8_t status;
+  rc = spi_nand_wait_status(&timing_erase, die_op[die].start_us, wait, &status);
+  if (rc == -ETIMEDOUT) {
+    die_op[die].erasing = false;
+    die_op[die].result = rc;
+  }
+  if (rc != 0) {
+    return rc;
+  }
+
+  die_op[die].erasing = false;
+
+  if (status & STATUS_BIT_ERASE_FAIL_MASK) {
+    LOG_ERR("Block %d/%d erase fail", die, die_op[die].block % inst.blocks_per_die);
+    die_op[die].result = -EIO;
+  } else {
+    spi_nand_block_mark_erased(die_op[die].block, true);
+    die_op[die].result = 0;
+  }
+
+  return 0;
+}
+
+static int spi_nand_die_select(uint8_t die_num)
+{
+  spi_nand_die_settle(die_num, true);
+
+  return spi_nand_die_switch(die_num);
+}
+
+/*
+ * SET FEATURE for the per-die registers, skipped when the shadow already holds `val`
+ */
+static int spi_nand_set_die_feature(const uint8_t addr, const uint8_t val)
+{
+  uint16_t *shadow = NULL;
+
+  if (chip.die >= 0) {
+    shadow = (addr == REG_BLOCK_LOCK) ? &chip.lock[chip.die] :
+             (addr == REG_CONFIGURATION) ? &chip.config[chip.die] : NULL;
+  }
+
+  if (shadow && *shadow == val) {
+    stats.skipped_cmds++;
+    return 0;
+  }
+
+  int rc = spi_nand_set_feature(addr, val);
+  if (shadow) {
+    *shadow = (rc == 0) ? val : SHADOW_UNKNOWN;
+  }
+
+  return rc;
+}
+
 static int spi_nand_reset(void) {
   uint8_t tx_data[] = {COMMAND_RESET};
 
+  // RESET aborts a running erase, the block stays unerased
+  spi_nand_shadow_invalidate();
+  memset(die_op, 0, sizeof(die_op));
+
   struct spi_buf spi_buf[] = {
     {
       .buf = tx_data,
@@ -175,13 +489,19 @@ static int spi_nand_reset(void) {
     .count = 1,
 	};
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  return spi_nand_write(&spi_dev, &tx_set);
 }
 
 static int spi_nand_write_enable(void)
 {
   uint8_t tx_data[] = {COMMAND_WRITE_ENABLE};
 
+  // WEL stays set until the next PROGRAM EXECUTE or BLOCK ERASE
+  if (chip.wel) {
+    stats.skipped_cmds++;
+    return 0;
+  }
+
   struct spi_buf spi_buf[] = {
     {
       .buf = tx_data,
@@ -194,7 +514,10 @@ static int spi_nand_write_enable(void)
     .count = 1,
 	};
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  int rc = spi_nand_write(&spi_dev, &tx_set);
+  chip.wel = (rc == 0);
+
+  return rc;
 }
 
 static void spi_nand_unlock(uint8_t die_number)
@@ -208,11 +531,15 @@ static void spi_nand_unlock(uint8_t die_number)
     
   }
 
+  if (chip.lock[die_number] == 0) {
+    return;
+  }
+
   spi_nand_write_enable();
   
   // Unlock the flash memory
   {
-    int rc = spi_nand_set_feature(REG_BLOCK_LOCK, 0);
+    int rc = spi_nand_set_die_feature(REG_BLOCK_LOCK, 0);
 
     if (rc != 0) {
       LOG_ERR("Fail to unlock NAND: %d", rc);
@@ -221,43 +548,75 @@ static void spi_nand_unlock(uint8_t die_number)
   }
 }
 
-static int spi_nand_wait_until_ready(void)
+static uint16_t spi_nand_logical_blocks_per_die(void)
 {
-  int ret;
-  uint8_t reg = 0;
+  return inst.blocks_per_die - RESERVED_BLOCKS_PER_DIE;
+}
 
-  do {
-    ret = spi_nand_get_feature(REG_STATUS, &reg);
-  } while (!ret && (reg & STATUS_BIT_OIP_MASK));
+static uint32_t spi_nand_bytes_per_block(void)
+{
+  return (uint32_t)inst.bytes_per_page * inst.pages_per_block;
+}
 
-  return ret;
+static uint32_t spi_nand_block_index(const mt29f_row_addr_t addr)
+{
+  return (uint32_t)addr.die_num * inst.blocks_per_die + addr.blk_num;
 }
 
-static mt29f_row_addr_t spi_nand_offset_to_row_addr(const off_t offset)
+static bool spi_nand_block_is_bad(const uint32_t block)
+{
+  return (bbt.bad[block / 32] & BIT(block % 32)) != 0;
+}
+
+/*
+ * Maps a logical block onto its physical die/block, following the remap table
+ */
+static mt29f_row_addr_t spi_nand_block_to_row_addr(const uint32_t lblock)
 {
   mt29f_row_addr_t row_addr = {0};
 
-  const uint64_t bytes_per_block = inst.bytes_per_page * inst.pages_per_block;
-  const uint64_t bytes_per_die = bytes_per_block * inst.blocks_per_die;
+  row_addr.die_num = lblock / spi_nand_logical_blocks_per_die();
+  row_addr.blk_num = lblock % spi_nand_logical_blocks_per_die();
 
-  row_addr.die_num = offset / (bytes_per_die);
-  row_addr.blk_num = (offset % bytes_per_die) / bytes_per_block;
+  for (uint16_t i = 0; i < bbt.num_remap; i++) {
+    if (bbt.remap[i].logical == lblock) {
+      row_addr.blk_num = bbt.remap[i].physical;
+      break;
+    }
+  }
+
+  return row_addr;
+}
+
+static mt29f_row_addr_t spi_nand_offset_to_row_addr(const off_t offset)
+{
+  const uint32_t bytes_per_block = spi_nand_bytes_per_block();
 
-  const off_t page_offset = (offset % bytes_per_die) % bytes_per_block;
-  row_addr.page_num = (page_offset % bytes_per_block) / inst.bytes_per_page;
+  mt29f_row_addr_t row_addr = spi_nand_block_to_row_addr(offset / bytes_per_block);
+  row_addr.page_num = (offset % bytes_per_block) / inst.bytes_per_page;
 
   return row_addr;
 }
 
-static void spi_nand_block_erase(const mt29f_row_addr_t addr)
+static uint32_t spi_nand_row_addr_to_address(const mt29f_row_addr_t row_addr)
+{
+  uint32_t address = (row_addr.blk_num & 0x07FF) << BLOCK_POS;
+  address |= (row_addr.page_num & 0x003F) << PAGE_POS;
+
+  return address;
+}
+
+/*
+ * Issues BLOCK ERASE without waiting for tBERS, so the other die can be started meanwhile
+ */
+static int spi_nand_block_erase_start(const mt29f_row_addr_t addr)
 {
   spi_nand_die_select(addr.die_num);
 
   spi_nand_write_enable();
 
   // Row address
-  uint32_t address = (addr.blk_num & 0x07FF) << BLOCK_POS;
-  address |= (addr.page_num & 0x003F) << PAGE_POS;
+  const uint32_t address = spi_nand_row_addr_to_address(addr);
 
   uint8_t tx_data[] = {
     COMMAND_BLOCK_ERASE,
@@ -280,13 +639,62 @@ static void spi_nand_block_erase(const mt29f_row_addr_t addr)
 
   LOG_DBG("Block %d erase: %d", addr.blk_num, address);
 
-  int ret = spi_write_dt(&spi_dev, &tx_set);
+  int ret = spi_nand_write(&spi_dev, &tx_set);
+  chip.wel = false;
   if (ret != 0) {
     LOG_ERR("Block erase failed: %d", ret);
-    return;
+    return ret;
+  }
+
+  die_op[addr.die_num].erasing = true;
+  die_op[addr.die_num].block = spi_nand_block_index(addr);
+  die_op[addr.die_num].start_us = spi_nand_now_us();
+
+  return ret;
+}
+
+/*
+ * Waits for the erase running on the die of `addr` and checks E_FAIL
+ */
+static int spi_nand_block_erase_finish(const mt29f_row_addr_t addr)
+{
+  int ret = spi_nand_die_settle(addr.die_num, true);
+
+  return (ret != 0) ? ret : die_op[addr.die_num].result;
+}
+
+/*
+ * Removes a physical block from the background erase queue
+ */
+static void spi_nand_erase_queue_drop(const uint32_t block)
+{
+  for (uint8_t i = 0; i < erase_queue_count; ) {
+    if (spi_nand_block_index(spi_nand_block_to_row_addr(erase_queue[i])) == block) {
+      erase_queue[i] = erase_queue[--erase_queue_count];
+    } else {
+      i++;
+    }
+  }
+}
+
+/*
+ * True while `block` is being erased in the background
+ */
+static bool spi_nand_block_is_erasing(const uint32_t block)
+{
+  const uint8_t die = block / inst.blocks_per_die;
+
+  return die_op[die].erasing && die_op[die].block == block;
+}
+
+static int spi_nand_block_erase(const mt29f_row_addr_t addr)
+{
+  int ret = spi_nand_block_erase_start(addr);
+  if (ret != 0) {
+    return ret;
   }
 
-  spi_nand_wait_until_ready();
+  return spi_nand_block_erase_finish(addr);
 }
 
 static int spi_nand_page_load(const uint32_t row_addr) {
@@ -311,18 +719,163 @@ static int spi_nand_page_load(const uint32_t row_addr) {
 
   LOG_DBG("Page load: %d", row_addr);
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  return spi_nand_write(&spi_dev, &tx_set);
+}
+
+/*
+ * Decodes the ECCS0..2 bits of the status register for the page in the cache register
+ */
+static int spi_nand_ecc_decode(const uint8_t status)
+{
+  const uint8_t eccs = (status & (STATUS_BIT_ECCS0_MASK | STATUS_BIT_ECCS1_MASK | STATUS_BIT_ECCS2_MASK)) >> 4;
+
+  switch (eccs) {
+    case ECC_STATUS_OK:
+      return MT29F_ECC_CLEAN;
+    case ECC_STATUS_1_3_NR:
+      return MT29F_ECC_CORRECTED;
+    case ECC_STATUS_4_6_R:
+    case ECC_STATUS_7_8_R:
+      return MT29F_ECC_REFRESH;
+    default:
+      return -EBADMSG;
+  }
+}
+
+/*
+ * PAGE_READ into the cache register, repeated up to READ_RETRIES times while the
+ * on-die ECC reports the page as uncorrectable. Returns the ECC status of the page.
+ */
+static int spi_nand_page_load_checked(const uint32_t row_addr)
+{
+  int ecc = -EBADMSG;
+
+  for (int attempt = 0; attempt <= READ_RETRIES && ecc == -EBADMSG; attempt++) {
+    if (attempt > 0) {
+      LOG_WRN("Uncorrectable ECC on page %d, retry %d", row_addr, attempt);
+    }
+
+    const uint32_t start = spi_nand_now_us();
+    int rc = spi_nand_page_load(row_addr);
+    if (rc != 0) {
+      LOG_ERR("Page Load Failed: %d", rc);
+      return rc;
+    }
+
+    uint8_t status;
+    rc = spi_nand_wait_status(&timing_read, start, true, &status);
+    if (rc != 0) {
+      return rc;
+    }
+
+    ecc = spi_nand_ecc_decode(status);
+  }
+
+  return ecc;
+}
+
+/*
+ * Remembers a logical block whose data should be rewritten before it degrades further
+ */
+static void spi_nand_refresh_queue_add(const uint32_t lblock)
+{
+  for (uint8_t i = 0; i < refresh_queue_count; i++) {
+    if (refresh_queue[i] == lblock) {
+      return;
+    }
+  }
+
+  if (refresh_queue_count < REFRESH_QUEUE_LEN) {
+    refresh_queue[refresh_queue_count++] = lblock;
+    LOG_INF("Block %d queued for refresh", lblock);
+  } else {
+    LOG_WRN("Refresh queue full, dropping block %d", lblock);
+  }
+}
+
+/*
+ * Folds the ECC status of one page into the result of a multi-page read
+ */
+static int spi_nand_ecc_merge(const int worst, const int ecc)
+{
+  if (worst < 0 || ecc < 0) {
+    return MIN(worst, ecc);
+  }
+  return MAX(worst, ecc);
+}
+
+/*
+ * Picks the opcode variant matching the active bus width
+ */
+static uint8_t spi_nand_bus_cmd(const uint8_t cmd_x1, const uint8_t cmd_x2, const uint8_t cmd_x4)
+{
+  switch (bus_width) {
+    case 4:
+      return cmd_x4;
+    case 2:
+      return cmd_x2;
+    default:
+      return cmd_x1;
+  }
+}
+
+/*
+ * Runs the data phase of a wide command. The command bytes go out on a single line
+ * with CS held, then the payload is clocked on 2 or 4 lines and CS is released.
+ */
+static int spi_nand_wide_transfer(const uint8_t *cmd, const size_t cmd_len,
+                                  const uint8_t *tx, uint8_t *rx, const size_t len)
+{
+  const struct spi_dt_spec *data_spec = (bus_width == 4) ? &spi_dev_x4 : &spi_dev_x2;
+
+  struct spi_buf cmd_buf = {
+    .buf = (void *)cmd,
+    .len = cmd_len,
+  };
+
+  const struct spi_buf_set cmd_set = {
+    .buffers = &cmd_buf,
+    .count = 1,
+  };
+
+  struct spi_buf data_buf = {
+    .buf = rx ? (void *)rx : (void *)tx,
+    .len = len,
+  };
+
+  const struct spi_buf_set data_set = {
+    .buffers = &data_buf,
+    .count = 1,
+  };
+
+  int rc = spi_nand_write(&spi_dev_hold, &cmd_set);
+  if (rc == 0) {
+    if (rx) {
+      rc = spi_transceive_dt(data_spec, NULL, &data_set);
+    } else {
+      rc = spi_write_dt(data_spec, &data_set);
+    }
+  }
+
+  spi_release_dt(&spi_dev_hold);
+
+  return rc;
 }
 
 static int spi_nand_page_cache_read(const mt29f_col_addr_t col_addr, uint8_t *dest, const size_t len)
 {
   uint8_t tx_data[] = {
-    COMMAND_READ_FROM_CACHE_x1,
+    spi_nand_bus_cmd(COMMAND_READ_FROM_CACHE_x1, COMMAND_READ_FROM_CACHE_x2, COMMAND_READ_FROM_CACHE_x4),
     (col_addr >> 8) & 0xFF,
     col_addr & 0xFF,
     DUMMY_BYTE
   };
 
+  if (bus_width > 1) {
+    LOG_DBG("Cache read x%d at %02X: %d bytes", bus_width, col_addr, len);
+    return spi_nand_wide_transfer(tx_data, ARRAY_SIZE(tx_data), NULL, dest, len);
+  }
+
   struct spi_buf spi_buf[2] = {
     {
       .buf = tx_data,
@@ -346,79 +899,38 @@ static int spi_nand_page_cache_read(const mt29f_col_addr_t col_addr, uint8_t *de
 
   LOG_DBG("Cache read at %02X: %d bytes", col_addr, len);
 
-  return spi_transceive_dt(&spi_dev, &tx_set, &rx_set);
-}
-
-static int spi_nand_page_read(const off_t offset, uint8_t *dest, const size_t len)
-{
-  int rc = 0;
-
-  mt29f_row_addr_t row_addr = spi_nand_offset_to_row_addr(offset);
-
-  spi_nand_die_select(row_addr.die_num);
-
-  LOG_DBG("Page read: %ld", offset);
-  LOG_DBG("Die: %d; Blk: %d; Page: %d", row_addr.die_num, row_addr.blk_num, row_addr.page_num);
-
-  // Row address select
-  uint32_t address = (row_addr.blk_num & 0x07FF) << BLOCK_POS;
-  address |= (row_addr.page_num & 0x003F) << PAGE_POS;
-
-  rc = spi_nand_page_load(address);
-  if (rc != 0) {
-    LOG_ERR("Page Load Failed: %d", rc);
-    return rc;
-  }
-
-  spi_nand_wait_until_ready();
-
-  // This only reads 1 whole page at a time
-  rc = spi_nand_page_cache_read(0, dest, inst.bytes_per_page);
-  if (rc != 0) {
-    LOG_ERR("Page Cache Read Failed: %d", rc);
-    return rc;
-  }
-  
-  return rc;
+  return spi_nand_transceive(&spi_dev, &tx_set, &rx_set);
 }
 
-static int spi_nand_program_load(const mt29f_col_addr_t col_addr, const uint8_t *data, const size_t len)
+static int spi_nand_page_cache_load(const uint32_t row_addr)
 {
   uint8_t tx_data[] = {
-    COMMAND_PROGRAM_LOAD_x1,
-    (col_addr >> 8) & 0xFF,
-    col_addr & 0xFF
+    COMMAND_READ_PAGE_CACHE_RANDOM,
+    (row_addr >> 16) & 0xFF,
+    (row_addr >> 8) & 0xFF,
+    row_addr & 0xFF
   };
 
-  struct spi_buf spi_buf[2] = {
+  struct spi_buf spi_buf[] = {
     {
       .buf = tx_data,
       .len = ARRAY_SIZE(tx_data),
-    },
-    {
-      .buf = (void *)data,
-      .len = len
     }
   };
 
   const struct spi_buf_set tx_set = {
     .buffers = spi_buf,
-    .count = 2,
+    .count = 1,
   };
 
-  LOG_DBG("Program load at %02X: %d bytes", col_addr, len);
+  LOG_DBG("Page cache load: %d", row_addr);
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  return spi_nand_write(&spi_dev, &tx_set);
 }
 
-static int spi_nand_program_execute(const uint32_t mt29f_row_addr)
+static int spi_nand_page_cache_last(void)
 {
-  uint8_t tx_data[] = {
-    COMMAND_PROGRAM_EXECUTE,
-    (mt29f_row_addr >> 16) & 0xFF,
-    (mt29f_row_addr >> 8) & 0xFF,
-    mt29f_row_addr & 0xFF
-  };
+  uint8_t tx_data[] = {COMMAND_READ_PAGE_CACHE_LAST};
 
   struct spi_buf spi_buf[] = {
     {
@@ -432,49 +944,988 @@ static int spi_nand_program_execute(const uint32_t mt29f_row_addr)
     .count = 1,
   };
 
-  LOG_DBG("Program execute page %d", mt29f_row_addr);
+  LOG_DBG("Page cache last");
 
-  return spi_write_dt(&spi_dev, &tx_set);
+  return spi_nand_write(&spi_dev, &tx_set);
 }
 
-static int spi_nand_page_write(const off_t offset, const uint8_t *data, const size_t len)
+/*
+ * Byte range of a multi-page read: `len` bytes from column `col` of the first page on,
+ * continuing at column 0 of the following pages. Only the first `span` bytes of every
+ * page belong to the range, so a span of the main area size skips the spare areas.
+ */
+typedef struct spi_nand_span {
+  uint16_t  col;
+  uint16_t  span;
+  size_t    len;
+} spi_nand_span_t;
+
+static size_t spi_nand_span_pages(const spi_nand_span_t *s)
 {
-  int rc = 0;
+  return DIV_ROUND_UP(s->col + s->len, s->span);
+}
 
-  mt29f_row_addr_t row_addr = spi_nand_offset_to_row_addr(offset);
+/*
+ * Part of page `i` that belongs to the range: its column, its position in `dest` and
+ * its length
+ */
+static size_t spi_nand_span_page(const spi_nand_span_t *s, const size_t i, mt29f_col_addr_t *col,
+                                 size_t *pos)
+{
+  *col = (i == 0) ? s->col : 0;
+  *pos = (i == 0) ? 0 : i * s->span - s->col;
+
+  return MIN(s->span - *col, s->len - *pos);
+}
+
+/*
+ * Reads the range `s` out of consecutive pages from `offset` on that all sit on the
+ * same die.
+ *
+ * A single page uses the plain PAGE_READ -> READ_FROM_CACHE sequence. Longer runs
+ * use cache-read mode: every READ_PAGE_CACHE_RANDOM moves the previous page into
+ * the cache register and starts loading the next one into the data register, so
+ * tR of page N+1 overlaps with the host clocking page N out of the cache.
+ *
+ * The ECC status bits always describe the page sitting in the cache register, so they
+ * are sampled right before that page is clocked out. Pages the ECC could not correct
+ * are re-read on their own with plain page reads once the pipeline has drained.
+ *
+ * Returns the worst mt29f_ecc_t of the run, or -EBADMSG.
+ */
+static int spi_nand_page_run_read(const off_t offset, uint8_t *dest, const spi_nand_span_t *s)
+{
+  int rc = 0;
+  int worst = MT29F_ECC_CLEAN;
+  uint8_t status;
+  mt29f_col_addr_t col;
+  size_t pos;
+
+  const size_t num_pages = spi_nand_span_pages(s);
+
+  size_t failed[READ_RETRY_MAX_PAGES];
+  size_t num_failed = 0;
+
+  mt29f_row_addr_t row_addr = spi_nand_offset_to_row_addr(offset);
+
+  spi_nand_die_select(row_addr.die_num);
+
+  LOG_DBG("Page read: %ld (%d pages)", offset, num_pages);
+  LOG_DBG("Die: %d; Blk: %d; Page: %d", row_addr.die_num, row_addr.blk_num, row_addr.page_num);
+
+  uint32_t start = spi_nand_now_us();
+  rc = spi_nand_page_load(spi_nand_row_addr_to_address(row_addr));
+  if (rc != 0) {
+    LOG_ERR("Page Load Failed: %d", rc);
+    return rc;
+  }
+
+  rc = spi_nand_wait_status(&timing_read, start, true, &status);
+  if (rc != 0) {
+    return rc;
+  }
+
+  for (size_t i = 0; i < num_pages; i++) {
+    if (num_pages > 1) {
+      start = spi_nand_now_us();
+      if (i + 1 < num_pages) {
+        row_addr = spi_nand_offset_to_row_addr(offset + (i + 1) * inst.bytes_per_page);
+
+        rc = spi_nand_page_cache_load(spi_nand_row_addr_to_address(row_addr));
+        if (rc != 0) {
+          LOG_ERR("Page Cache Load Failed: %d", rc);
+          return rc;
+        }
+      } else {
+        rc = spi_nand_page_cache_last();
+        if (rc != 0) {
+          LOG_ERR("Page Cache Last Failed: %d", rc);
+          return rc;
+        }
+      }
+
+      // OIP only covers the data -> cache register transfer here, the array read
+      // of the next page keeps going in the background (CACHE_READ_BUSY)
+      rc = spi_nand_wait_status(&timing_cache_read, start, true, &status);
+      if (rc != 0) {
+        return rc;
+      }
+    }
+
+    const int ecc = spi_nand_ecc_decode(status);
+    if (ecc == -EBADMSG && num_failed < READ_RETRY_MAX_PAGES) {
+      failed[num_failed++] = i;
+    } else {
+      worst = spi_nand_ecc_merge(worst, ecc);
+      if (ecc == MT29F_ECC_REFRESH || ecc == -EBADMSG) {
+        spi_nand_refresh_queue_add((offset + i * inst.bytes_per_page) / spi_nand_bytes_per_block());
+      }
+    }
+
+    const size_t len = spi_nand_span_page(s, i, &col, &pos);
+    rc = spi_nand_page_cache_read(col, dest + pos, len);
+    if (rc != 0) {
+      LOG_ERR("Page Cache Read Failed: %d", rc);
+      return rc;
+    }
+  }
+
+  for (size_t f = 0; f < num_failed; f++) {
+    const off_t page_offset = offset + failed[f] * inst.bytes_per_page;
+    row_addr = spi_nand_offset_to_row_addr(page_offset);
+
+    const int ecc = spi_nand_page_load_checked(spi_nand_row_addr_to_address(row_addr));
+    if (ecc < 0 && ecc != -EBADMSG) {
+      return ecc;
+    }
+
+    const size_t len = spi_nand_span_page(s, failed[f], &col, &pos);
+    rc = spi_nand_page_cache_read(col, dest + pos, len);
+    if (rc != 0) {
+      LOG_ERR("Page Cache Read Failed: %d", rc);
+      return rc;
+    }
+
+    // A page that needed retries is marginal even if it came back clean
+    worst = spi_nand_ecc_merge(worst, (ecc == -EBADMSG) ? ecc : MT29F_ECC_REFRESH);
+    spi_nand_refresh_queue_add(page_offset / spi_nand_bytes_per_block());
+  }
+
+  return worst;
+}
+
+/*
+ * Reads the range `s` from the page at `offset` on, one cache-read run per die
+ */
+static int spi_nand_span_read(const off_t offset, uint8_t *dest, spi_nand_span_t s)
+{
+  int rc = 0;
+
+  const uint64_t bytes_per_die = (uint64_t)spi_nand_bytes_per_block() * spi_nand_logical_blocks_per_die();
+
+  off_t cur = offset;
+
+  // Cache reads cannot cross a die boundary, so split the request into per-die runs
+  while (s.len > 0) {
+    const size_t pages_left_in_die = (bytes_per_die - (cur % bytes_per_die)) / inst.bytes_per_page;
+    const size_t run = MIN(spi_nand_span_pages(&s), pages_left_in_die);
+
+    spi_nand_span_t part = s;
+    part.len = MIN(s.len, run * s.span - s.col);
+
+    const int ecc = spi_nand_page_run_read(cur, dest, &part);
+    if (ecc < 0 && ecc != -EBADMSG) {
+      return ecc;
+    }
+    rc = spi_nand_ecc_merge(rc, ecc);
+
+    cur += run * inst.bytes_per_page;
+    dest += part.len;
+    s.len -= part.len;
+    s.col = 0;
+  }
+
+  return rc;
+}
+
+static int spi_nand_page_read(const off_t offset, uint8_t *dest, const size_t len)
+{
+  const spi_nand_span_t s = {
+    .col = 0,
+    .span = inst.bytes_per_page,
+    .len = len
+  };
+
+  return spi_nand_span_read(offset, dest, s);
+}
+
+static int spi_nand_program_load(const mt29f_col_addr_t col_addr, const uint8_t *data, const size_t len)
+{
+  uint8_t tx_data[] = {
+    spi_nand_bus_cmd(COMMAND_PROGRAM_LOAD_x1, COMMAND_PROGRAM_LOAD_x2, COMMAND_PROGRAM_LOAD_x4),
+    (col_addr >> 8) & 0xFF,
+    col_addr & 0xFF
+  };
+
+  if (bus_width > 1) {
+    LOG_DBG("Program load x%d at %02X: %d bytes", bus_width, col_addr, len);
+    return spi_nand_wide_transfer(tx_data, ARRAY_SIZE(tx_data), data, NULL, len);
+  }
+
+  struct spi_buf spi_buf[2] = {
+    {
+      .buf = tx_data,
+      .len = ARRAY_SIZE(tx_data),
+    },
+    {
+      .buf = (void *)data,
+      .len = len
+    }
+  };
+
+  const struct spi_buf_set tx_set = {
+    .buffers = spi_buf,
+    .count = 2,
+  };
+
+  LOG_DBG("Program load at %02X: %d bytes", col_addr, len);
+
+  return spi_nand_write(&spi_dev, &tx_set);
+}
+
+static int spi_nand_program_load_random(const mt29f_col_addr_t col_addr, const uint8_t *data, const size_t len)
+{
+  uint8_t tx_data[] = {
+    spi_nand_bus_cmd(COMMAND_PROGRAM_LOAD_RANDOM_DATA_x1, COMMAND_PROGRAM_LOAD_RANDOM_DATA_x2,
+                     COMMAND_PROGRAM_LOAD_RANDOM_DATA_x4),
+    (col_addr >> 8) & 0xFF,
+    col_addr & 0xFF
+  };
+
+  if (bus_width > 1) {
+    LOG_DBG("Program load random x%d at %02X: %d bytes", bus_width, col_addr, len);
+    return spi_nand_wide_transfer(tx_data, ARRAY_SIZE(tx_data), data, NULL, len);
+  }
+
+  struct spi_buf spi_buf[2] = {
+    {
+      .buf = tx_data,
+      .len = ARRAY_SIZE(tx_data),
+    },
+    {
+      .buf = (void *)data,
+      .len = len
+    }
+  };
+
+  const struct spi_buf_set tx_set = {
+    .buffers = spi_buf,
+    .count = 2,
+  };
+
+  LOG_DBG("Program load random at %02X: %d bytes", col_addr, len);
+
+  return spi_nand_write(&spi_dev, &tx_set);
+}
+
+static int spi_nand_program_execute(const uint32_t mt29f_row_addr)
+{
+  uint8_t tx_data[] = {
+    COMMAND_PROGRAM_EXECUTE,
+    (mt29f_row_addr >> 16) & 0xFF,
+    (mt29f_row_addr >> 8) & 0xFF,
+    mt29f_row_addr & 0xFF
+  };
+
+  struct spi_buf spi_buf[] = {
+    {
+      .buf = tx_data,
+      .len = ARRAY_SIZE(tx_data),
+    }
+  };
+
+  const struct spi_buf_set tx_set = {
+    .buffers = spi_buf,
+    .count = 1,
+  };
+
+  LOG_DBG("Program execute page %d", mt29f_row_addr);
+
+  int rc = spi_nand_write(&spi_dev, &tx_set);
+  chip.wel = false;
+
+  return rc;
+}
+
+static int spi_nand_page_read_at(const mt29f_row_addr_t row_addr, const mt29f_col_addr_t col_addr,
+                                 uint8_t *dest, const size_t len)
+{
+  spi_nand_die_select(row_addr.die_num);
+
+  const int ecc = spi_nand_page_load_checked(spi_nand_row_addr_to_address(row_addr));
+  if (ecc < 0 && ecc != -EBADMSG) {
+    return ecc;
+  }
+
+  // An uncorrectable page is still handed out, the caller decides what is salvageable
+  int rc = spi_nand_page_cache_read(col_addr, dest, len);
+
+  return (rc != 0) ? rc : ecc;
+}
+
+/*
+ * Programs one page from several buffers. PROGRAM LOAD resets the whole cache register
+ * to 0xFF before taking the first part; the others are patched in with PROGRAM LOAD
+ * RANDOM DATA, so bytes no part covers never cross the bus and stay erased.
+ */
+static int spi_nand_page_program_parts(const mt29f_row_addr_t row_addr, const mt29f_part_t *parts,
+                                       const size_t count)
+{
+  int rc = 0;
+
+  spi_nand_die_select(row_addr.die_num);
+  spi_nand_write_enable();
+
+  for (size_t i = 0; i < count; i++) {
+    rc = (i == 0) ? spi_nand_program_load(parts[i].col, parts[i].data, parts[i].len)
+                  : spi_nand_program_load_random(parts[i].col, parts[i].data, parts[i].len);
+    if (rc != 0) {
+      LOG_ERR("Page Program Load Failed: %d", rc);
+      return rc;
+    }
+  }
+
+  const uint32_t start = spi_nand_now_us();
+  rc = spi_nand_program_execute(spi_nand_row_addr_to_address(row_addr));
+  if (rc != 0) {
+    LOG_ERR("Page Program Execute Failed: %d", rc);
+    return rc;
+  }
+
+  uint8_t status;
+  rc = spi_nand_wait_status(&timing_program, start, true, &status);
+  if (rc == 0 && (status & STATUS_BIT_PROGRAM_FAIL_MASK)) {
+    LOG_ERR("Block %d/%d page %d program fail", row_addr.die_num, row_addr.blk_num, row_addr.page_num);
+    rc = -EIO;
+  }
+
+  spi_nand_block_mark_erased(spi_nand_block_index(row_addr), false);
+
+  return rc;
+}
+
+static int spi_nand_page_program(const mt29f_row_addr_t row_addr, const mt29f_col_addr_t col_addr,
+                                 const uint8_t *data, const size_t len)
+{
+  const mt29f_part_t part = {
+    .col = col_addr,
+    .len = len,
+    .data = data
+  };
+
+  return spi_nand_page_program_parts(row_addr, &part, 1);
+}
+
+/*
+ * Internal data move: the page goes array -> cache register -> array without ever
+ * crossing the SPI bus. Source and destination must be on the same die. Optionally
+ * `patch` overwrites `patch_len` bytes of the cache register at `patch_col` first.
+ */
+static int spi_nand_page_move_patch(const mt29f_row_addr_t src, const mt29f_row_addr_t dst,
+                                    const mt29f_col_addr_t patch_col, const uint8_t *patch,
+                                    const size_t patch_len)
+{
+  int rc = 0;
+
+  spi_nand_die_select(src.die_num);
+
+  // The on-die ECC corrects the page on its way into the cache register and the
+  // program re-encodes it, so a move also refreshes marginal data
+  const int ecc = spi_nand_page_load_checked(spi_nand_row_addr_to_address(src));
+  if (ecc == -EBADMSG) {
+    LOG_WRN("Moving uncorrectable page %d", spi_nand_row_addr_to_address(src));
+  } else if (ecc < 0) {
+    return ecc;
+  }
+
+  spi_nand_write_enable();
+
+  if (patch) {
+    rc = spi_nand_program_load_random(patch_col, patch, patch_len);
+    if (rc != 0) {
+      return rc;
+    }
+  }
+
+  const uint32_t start = spi_nand_now_us();
+  rc = spi_nand_program_execute(spi_nand_row_addr_to_address(dst));
+  if (rc != 0) {
+    return rc;
+  }
+
+  uint8_t status;
+  rc = spi_nand_wait_status(&timing_program, start, true, &status);
+  if (rc == 0 && (status & STATUS_BIT_PROGRAM_FAIL_MASK)) {
+    rc = -EIO;
+  }
+
+  spi_nand_block_mark_erased(spi_nand_block_index(dst), false);
+
+  return rc;
+}
+
+static int spi_nand_page_move(const mt29f_row_addr_t src, const mt29f_row_addr_t dst)
+{
+  return spi_nand_page_move_patch(src, dst, 0, NULL, 0);
+}
+
+static bool spi_nand_block_is_bbt(const mt29f_row_addr_t addr)
+{
+  return addr.die_num == 0 && addr.blk_num >= inst.blocks_per_die - BBT_COPIES;
+}
+
+static void spi_nand_bbt_save(void)
+{
+  bbt.magic = BBT_MAGIC;
+  bbt.seq++;
+  bbt.crc = crc32_ieee((const uint8_t *)&bbt, offsetof(mt29f_bbt_t, crc));
+
+  // Rewrite one copy at a time so there is always a valid table on the chip
+  for (int i = 0; i < BBT_COPIES; i++) {
+    mt29f_row_addr_t addr = {.die_num = 0, .blk_num = inst.blocks_per_die - 1 - i, .page_num = 0};
+
+    if (spi_nand_block_erase(addr) != 0 ||
+        spi_nand_page_program(addr, 0, (const uint8_t *)&bbt, sizeof(bbt)) != 0) {
+      LOG_ERR("Failed to store bad block table copy %d", i);
+    }
+  }
+}
+
+static bool spi_nand_bbt_load(void)
+{
+  struct {
+    uint32_t magic;
+    uint32_t seq;
+  } hdr[BBT_COPIES];
+
+  for (int i = 0; i < BBT_COPIES; i++) {
+    mt29f_row_addr_t addr = {.die_num = 0, .blk_num = inst.blocks_per_die - 1 - i, .page_num = 0};
+    spi_nand_page_read_at(addr, 0, (uint8_t *)&hdr[i], sizeof(hdr[i]));
+  }
+
+  // Try the newest copy first, fall back to the other one if its CRC is bad
+  for (int attempt = 0; attempt < BBT_COPIES; attempt++) {
+    int best = -1;
+    for (int i = 0; i < BBT_COPIES; i++) {
+      if (hdr[i].magic == BBT_MAGIC && (best < 0 || hdr[i].seq > hdr[best].seq)) {
+        best = i;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+
+    mt29f_row_addr_t addr = {.die_num = 0, .blk_num = inst.blocks_per_die - 1 - best, .page_num = 0};
+    spi_nand_page_read_at(addr, 0, (uint8_t *)&bbt, sizeof(bbt));
+
+    if (bbt.magic == BBT_MAGIC &&
+        bbt.num_remap <= MAX_REMAP_ENTRIES &&
+        bbt.crc == crc32_ieee((const uint8_t *)&bbt, offsetof(mt29f_bbt_t, crc))) {
+      return true;
+    }
+
+    LOG_WRN("Bad block table copy %d corrupt", best);
+    hdr[best].magic = 0;
+  }
+
+  memset(&bbt, 0, sizeof(bbt));
+  return false;
+}
+
+/*
+ * Picks an unused, good replacement block from the reserved area of a die
+ */
+static int spi_nand_alloc_spare(const uint8_t die_num)
+{
+  for (uint16_t blk = spi_nand_logical_blocks_per_die(); blk < inst.blocks_per_die; blk++) {
+    mt29f_row_addr_t addr = {.die_num = die_num, .blk_num = blk, .page_num = 0};
+
+    if (spi_nand_block_is_bbt(addr) || spi_nand_block_is_bad(spi_nand_block_index(addr))) {
+      continue;
+    }
+
+    bool used = false;
+    for (uint16_t i = 0; i < bbt.num_remap; i++) {
+      if (bbt.remap[i].physical == blk &&
+          bbt.remap[i].logical / spi_nand_logical_blocks_per_die() == die_num) {
+        used = true;
+        break;
+      }
+    }
+
+    if (!used) {
+      return blk;
+    }
+  }
+
+  return -ENOSPC;
+}
+
+/*
+ * Marks the block currently backing `lblock` bad and maps `lblock` onto a spare
+ */
+static int spi_nand_retire_block(const uint32_t lblock, const bool save)
+{
+  const mt29f_row_addr_t old = spi_nand_block_to_row_addr(lblock);
+  const uint32_t old_index = spi_nand_block_index(old);
+
+  bbt.bad[old_index / 32] |= BIT(old_index % 32);
+
+  int spare = spi_nand_alloc_spare(old.die_num);
+  if (spare < 0) {
+    LOG_ERR("No spare blocks left on die %d", old.die_num);
+    if (save) {
+      spi_nand_bbt_save();
+    }
+    return spare;
+  }
+
+  uint16_t i;
+  for (i = 0; i < bbt.num_remap; i++) {
+    if (bbt.remap[i].logical == lblock) {
+      break;
+    }
+  }
+  if (i == bbt.num_remap) {
+    bbt.num_remap++;
+  }
+  bbt.remap[i].logical = lblock;
+  bbt.remap[i].physical = spare;
+
+  LOG_WRN("Block %d/%d retired, logical block %d now at %d/%d",
+      old.die_num, old.blk_num, lblock, old.die_num, spare);
+
+  if (save) {
+    spi_nand_bbt_save();
+  }
+
+  return 0;
+}
+
+/*
+ * Erases a logical block, retiring physical blocks that report an erase failure
+ */
+static int spi_nand_logical_block_erase(const uint32_t lblock)
+{
+  for (;;) {
+    mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+
+    int rc = spi_nand_block_erase(addr);
+    if (rc == 0) {
+      spi_nand_block_mark_erased(spi_nand_block_index(addr), true);
+      return 0;
+    }
+    if (rc != -EIO) {
+      return rc;
+    }
+
+    rc = spi_nand_retire_block(lblock, true);
+    if (rc != 0) {
+      return rc;
+    }
+  }
+}
+
+/*
+ * After a program failure on page `failed_page`: move the logical block to a spare
+ * and carry the pages that were already written across with internal data moves.
+ */
+static int spi_nand_relocate_block(const uint32_t lblock, const uint8_t failed_page)
+{
+  mt29f_row_addr_t old = spi_nand_block_to_row_addr(lblock);
+
+  int rc = spi_nand_retire_block(lblock, true);
+  if (rc != 0) {
+    return rc;
+  }
+
+  rc = spi_nand_logical_block_erase(lblock);
+  if (rc != 0) {
+    return rc;
+  }
+
+  mt29f_row_addr_t new = spi_nand_block_to_row_addr(lblock);
+
+  for (uint8_t page = 0; page < failed_page; page++) {
+    old.page_num = page;
+    new.page_num = page;
+
+    rc = spi_nand_page_move(old, new);
+    if (rc != 0) {
+      LOG_ERR("Relocation of logical block %d failed at page %d: %d", lblock, page, rc);
+      return rc;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Finds the next block of `lblocks` on `die` that still needs erasing, starting at *cursor
+ */
+static int spi_nand_next_dirty_on_die(const uint32_t *lblocks, const size_t count,
+                                      size_t *cursor, const uint8_t die)
+{
+  const uint16_t per_die = spi_nand_logical_blocks_per_die();
+
+  while (*cursor < count) {
+    const uint32_t lblock = lblocks[(*cursor)++];
+    if (lblock / per_die == die &&
+        !spi_nand_block_is_erased(spi_nand_block_index(spi_nand_block_to_row_addr(lblock)))) {
+      return lblock;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Erases a list of logical blocks with die interleaving: one erase is started on each
+ * die before waiting on either, so both dies spend tBERS in parallel. Blocks already
+ * known to be erased are skipped. Failing blocks go through the retiring path.
+ */
+static int spi_nand_logical_blocks_erase(const uint32_t *lblocks, const size_t count)
+{
+  int rc = 0;
+  size_t cursor[MAX_SUPPORTED_DIES] = {0};
+
+  for (;;) {
+    int lblock[MAX_SUPPORTED_DIES];
+    bool started[MAX_SUPPORTED_DIES] = {false};
+    bool any = false;
+
+    for (uint8_t die = 0; die < inst.num_dies && die < MAX_SUPPORTED_DIES; die++) {
+      lblock[die] = spi_nand_next_dirty_on_die(lblocks, count, &cursor[die], die);
+      if (lblock[die] >= 0) {
+        started[die] = (spi_nand_block_erase_start(spi_nand_block_to_row_addr(lblock[die])) == 0);
+        any = true;
+      }
+    }
+
+    if (!any) {
+      break;
+    }
+
+    for (uint8_t die = 0; die < inst.num_dies && die < MAX_SUPPORTED_DIES; die++) {
+      if (lblock[die] < 0) {
+        continue;
+      }
+
+      const mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock[die]);
+      int ret = started[die] ? spi_nand_block_erase_finish(addr) : -EIO;
+
+      if (ret == 0) {
+        spi_nand_block_mark_erased(spi_nand_block_index(addr), true);
+        continue;
+      }
+
+      // Slow path: retire the block and erase its replacement on its own
+      ret = spi_nand_retire_block(lblock[die], true);
+      if (ret == 0) {
+        ret = spi_nand_logical_block_erase(lblock[die]);
+      }
+      if (ret != 0) {
+        rc = ret;
+      }
+    }
+  }
+
+  return rc;
+}
+
+/*
+ * Blank check on page 0: every writer of this driver programs page 0 of a block
+ * first, so an unprogrammed page 0 means the whole block is still erased
+ */
+static bool spi_nand_block_is_blank(const uint32_t lblock)
+{
+  const mt29f_col_addr_t spare_col = inst.bytes_per_page - inst.oob_bytes;
+
+  mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+  addr.page_num = 0;
+
+  uint8_t probe[16];
+  if (spi_nand_page_read_at(addr, 0, probe, sizeof(probe)) < 0) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(probe); i++) {
+    if (probe[i] != 0xFF) {
+      return false;
+    }
+  }
+
+  // The page is still in the cache register, the spare area costs no second tR
+  if (spi_nand_page_cache_read(spare_col + OOB_USER_POS, probe, sizeof(probe)) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(probe); i++) {
+    if (probe[i] != 0xFF) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void spi_nand_bbt_scan(void)
+{
+  const mt29f_col_addr_t spare_col = inst.bytes_per_page - inst.oob_bytes;
+
+  memset(&bbt, 0, sizeof(bbt));
 
-  spi_nand_die_select(row_addr.die_num);
-  spi_nand_write_enable();
+  for (uint8_t die = 0; die < inst.num_dies; die++) {
+    for (uint16_t blk = 0; blk < inst.blocks_per_die; blk++) {
+      mt29f_row_addr_t addr = {.die_num = die, .blk_num = blk, .page_num = 0};
+      uint8_t marker = 0xFF;
+
+      spi_nand_page_read_at(addr, spare_col + OOB_BAD_BLOCK_MARKER_POS, &marker, 1);
+      if (marker != 0xFF) {
+        const uint32_t index = spi_nand_block_index(addr);
+        bbt.bad[index / 32] |= BIT(index % 32);
+        LOG_INF("Factory bad block %d/%d", die, blk);
+      }
+    }
+  }
+
+  // Map every factory bad block inside the logical range onto a spare
+  const uint32_t num_blocks = (uint32_t)inst.num_dies * spi_nand_logical_blocks_per_die();
+  for (uint32_t lblock = 0; lblock < num_blocks; lblock++) {
+    mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+
+    while (spi_nand_block_is_bad(spi_nand_block_index(addr))) {
+      if (spi_nand_retire_block(lblock, false) != 0) {
+        break;
+      }
+      addr = spi_nand_block_to_row_addr(lblock);
+    }
+  }
+
+  spi_nand_bbt_save();
+}
+
+static int spi_nand_page_write_parts(const off_t offset, const mt29f_part_t *parts, const size_t count,
+                                     const bool inline_erase)
+{
+  int rc = 0;
+
+  const uint32_t lblock = offset / spi_nand_bytes_per_block();
+  mt29f_row_addr_t row_addr = spi_nand_offset_to_row_addr(offset);
 
-  // TODO: This is destructive, but required before writing to an already-written block
+  // A block must be erased before its first page is programmed. Normally the erase
+  // worker already did that ahead of time (it may still be finishing); only fall back
+  // to a synchronous erase when the block is not in the pre-erased pool.
+  const uint32_t block = spi_nand_block_index(row_addr);
   if (row_addr.page_num == 0) {
-    spi_nand_block_erase(row_addr);
+    spi_nand_die_settle(row_addr.die_num, true);
   }
+  if (inline_erase && row_addr.page_num == 0 && !spi_nand_block_is_erased(block)) {
+    LOG_WRN("Block %d not pre-erased, erasing inline", block);
+    rc = spi_nand_logical_block_erase(lblock);
+    if (rc != 0) {
+      return rc;
+    }
+    row_addr = spi_nand_offset_to_row_addr(offset);
+  }
+
+  rc = spi_nand_page_program_parts(row_addr, parts, count);
+
+  // Grown bad block: move what is already in the block to a spare and retry there
+  while (rc == -EIO) {
+    rc = spi_nand_relocate_block(lblock, row_addr.page_num);
+    if (rc != 0) {
+      return rc;
+    }
+
+    row_addr = spi_nand_offset_to_row_addr(offset);
+    rc = spi_nand_page_program_parts(row_addr, parts, count);
+  }
+
+  return rc;
+}
 
+static int spi_nand_page_write(const off_t offset, const uint8_t *data, const size_t len)
+{
   // This only writes 1 whole page at a time
-  rc = spi_nand_program_load(0, data, inst.bytes_per_page);
-  if (rc != 0) {
-    LOG_ERR("Page Program Load Failed: %d", rc);
-    return rc;
+  const mt29f_part_t page = {
+    .col = 0,
+    .len = inst.bytes_per_page,
+    .data = data
+  };
+
+  return spi_nand_page_write_parts(offset, &page, 1, true);
+}
+
+/*
+ * Multi-page program. Every page is loaded and executed in turn; the caller is
+ * responsible for holding `nand_lock`.
+ */
+static int spi_nand_pages_write(const off_t offset, const uint8_t *data, const size_t len)
+{
+  int rc = 0;
+
+  for (size_t done = 0; done < len; done += inst.bytes_per_page) {
+    rc = spi_nand_page_write(offset + done, &data[done], inst.bytes_per_page);
+    if (rc != 0) {
+      return rc;
+    }
   }
 
-  spi_nand_write_enable();
+  return rc;
+}
 
-  // Row address select
-  uint32_t address = (row_addr.blk_num & 0x07FF) << BLOCK_POS;
-  address |= (row_addr.page_num & 0x003F) << PAGE_POS;
+/*
+ * Selects the widest bus mode up to the devicetree `bus-width` that the SPI controller
+ * accepts, x1 on a shared bus. Quad mode needs the QE bit, which turns WP#/HOLD# into IO2/IO3.
+ */
+static void spi_nand_bus_setup(void)
+{
+  uint8_t probe;
 
-  rc = spi_nand_program_execute(address);
-  if (rc != 0) {
-    LOG_ERR("Page Program Execute Failed: %d", rc);
-    return rc;
+  bus_width = MT29F_DT_BUS_WIDTH;
+  if (bus_width > 1 && MT29F_DT_BUS_DEVICES > 1) {
+    LOG_WRN("Shared SPI bus (%d devices), x%d transfers disabled", MT29F_DT_BUS_DEVICES, bus_width);
+    bus_width = 1;
+  }
+
+  for (; bus_width > 1; bus_width /= 2) {
+    const uint8_t cfg = SEC_STATUS_BIT_ECC_EN | ((bus_width == 4) ? SEC_STATUS_BIT_QE : 0);
+
+    spi_nand_set_die_feature(REG_CONFIGURATION, cfg);
+
+    // Controllers without multi-line support reject the configuration up front
+    int rc = spi_nand_page_cache_read(0, &probe, 1);
+    if (rc == 0) {
+      break;
+    }
+
+    LOG_WRN("SPI controller does not support x%d transfers (%d), falling back", bus_width, rc);
+  }
+
+  if (bus_width == 1) {
+    spi_nand_set_die_feature(REG_CONFIGURATION, SEC_STATUS_BIT_ECC_EN);
+  }
+
+  LOG_INF("Bus width: x%d", bus_width);
+}
+
+/*
+ * Starts the erase of `lblock` unless it is erased already, or joins one already
+ * running. Called with `nand_lock` held.
+ */
+static int spi_nand_background_erase_start(const uint32_t lblock, bool *started)
+{
+  const mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+  const uint32_t block = spi_nand_block_index(addr);
+
+  *started = false;
+  if (spi_nand_block_is_erased(block)) {
+    return 0;
   }
 
-  spi_nand_wait_until_ready();
+  *started = true;
+  return spi_nand_block_is_erasing(block) ? 0 : spi_nand_block_erase_start(addr);
+}
+
+/*
+ * Waits out tBERS with `nand_lock` released, polling only the block's own die on the
+ * timing_erase schedule, so the other die keeps serving reads and programs meanwhile
+ */
+static int spi_nand_background_erase_wait(const uint32_t lblock)
+{
+  const mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+  const uint32_t block = spi_nand_block_index(addr);
+  int rc;
+
+  uint32_t delay = timing_erase.typ_us;
+  do {
+    k_usleep(delay);
+    delay = timing_erase.poll_us;
+
+    k_mutex_lock(&nand_lock, K_FOREVER);
+    rc = spi_nand_die_settle(addr.die_num, false);
+    k_mutex_unlock(&nand_lock);
+  } while (rc == -EBUSY);
+
+  if (rc == 0) {
+    k_mutex_lock(&nand_lock, K_FOREVER);
+    rc = spi_nand_block_is_erased(block) ? 0 : -EIO;
+    k_mutex_unlock(&nand_lock);
+  }
+
+  LOG_DBG("Background erased block %d: %d", lblock, rc);
 
   return rc;
 }
 
+/*
+ * Erases `lblock` without holding `nand_lock` for tBERS. A failed erase leaves the
+ * block unerased and returns -EIO; the inline erase of its first write then retires it.
+ */
+static int spi_nand_background_erase(const uint32_t lblock)
+{
+  bool started;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_background_erase_start(lblock, &started);
+  k_mutex_unlock(&nand_lock);
+
+  if (rc != 0 || !started) {
+    return rc;
+  }
+
+  return spi_nand_background_erase_wait(lblock);
+}
+
+/*
+ * Erase worker: erases the blocks queued with mt29f_erase_block_async(), so the FTL
+ * never has to wait out tBERS when it opens its next free block
+ */
+static void spi_nand_erase_handler(struct k_work *work)
+{
+  ARG_UNUSED(work);
+
+  for (;;) {
+    k_mutex_lock(&nand_lock, K_FOREVER);
+
+    if (erase_queue_count == 0) {
+      k_mutex_unlock(&nand_lock);
+      break;
+    }
+
+    // Pop and start under one lock hold, so a program can't slip in between and
+    // leave data in a block the erase then wipes
+    const uint16_t block = erase_queue[--erase_queue_count];
+    bool started;
+    int rc = spi_nand_background_erase_start(block, &started);
+
+    k_mutex_unlock(&nand_lock);
+
+    if (rc == 0 && started) {
+      spi_nand_background_erase_wait(block);
+    }
+  }
+}
+
+/*
+ * Runs one mt29f_submit() operation on the erase work queue and reports its result
+ */
+static void spi_nand_op_handler(struct k_work *work)
+{
+  mt29f_op_t *op = CONTAINER_OF(work, mt29f_op_t, work);
+
+  switch (op->type) {
+  case MT29F_OP_READ:
+    op->result = mt29f_read(op->offset, op->data, op->len);
+    break;
+  case MT29F_OP_WRITE:
+    op->result = mt29f_write(op->offset, op->data, op->len);
+    break;
+  case MT29F_OP_ERASE:
+    op->result = spi_nand_background_erase(op->offset / spi_nand_bytes_per_block());
+    break;
+  default:
+    op->result = -ENOTSUP;
+    break;
+  }
+
+  if (op->cb) {
+    op->cb(op);
+  }
+  if (op->signal) {
+    k_poll_signal_raise(op->signal, op->result);
+  }
+}
+
 /**
  * --------------------------------------------------------
  * Public API
@@ -490,6 +1941,7 @@ void mt29f_init(mt29f_cfg_t const *cfg)
     return;
   }
   inst = *cfg;
+  chip_ready = false;
 
   if (!spi_is_ready_dt(&spi_dev)) {
     LOG_ERR("SPI device not initialized!");
@@ -497,6 +1949,7 @@ void mt29f_init(mt29f_cfg_t const *cfg)
   }
 
   // Reset the flash memory
+  const uint32_t reset_start = spi_nand_now_us();
   {
     int rc = spi_nand_reset();
     if (rc) {
@@ -505,8 +1958,13 @@ void mt29f_init(mt29f_cfg_t const *cfg)
   }
  
   // Wait for power on reset (Datasheet value is equal to 1.25mSec)
-  k_msleep(2);
-  spi_nand_wait_until_ready();
+  {
+    uint8_t status;
+    int rc = spi_nand_wait_status(&timing_reset, reset_start, true, &status);
+    if (rc) {
+      LOG_ERR("NAND not ready after reset! err: %d", rc);
+    }
+  }
 
   // Check ID response 
   {
@@ -521,18 +1979,53 @@ void mt29f_init(mt29f_cfg_t const *cfg)
 
   // Enable ECC
   {
-    int rc = spi_nand_set_feature(REG_CONFIGURATION, SEC_STATUS_BIT_ECC_EN);
+    int rc = spi_nand_set_die_feature(REG_CONFIGURATION, SEC_STATUS_BIT_ECC_EN);
     if (rc != 0) {
       LOG_ERR("Set Feature Failed: %d", rc);
     }
   }
 
-  spi_nand_unlock(DIE_1);
-  spi_nand_unlock(DIE_0);
+  // Widen the data phase of bulk transfers as far as the board allows (sets QE for x4)
+  spi_nand_bus_setup();
+
+  spi_nand_unlock(1);
+  spi_nand_unlock(0);
+
+  if (inst.num_dies * inst.blocks_per_die > MAX_SUPPORTED_BLOCKS) {
+    LOG_ERR("Block tables too small for %d blocks", inst.num_dies * inst.blocks_per_die);
+    return;
+  }
+
+  // Bad block table: load the stored copy, only scan the chip if there is none
+  if (!spi_nand_bbt_load()) {
+    LOG_INF("No bad block table found, scanning for factory bad blocks...");
+    spi_nand_bbt_scan();
+  }
+  LOG_INF("Bad blocks: %d, remapped: %d", mt29f_get_bad_block_count(), bbt.num_remap);
+
+  // Start the low priority erase worker, init may run again after a reset
+  if (!erase_workq_started) {
+    const struct k_work_queue_config workq_cfg = {
+      .name = "mt29f_erase",
+    };
+
+    k_work_queue_init(&erase_workq);
+    k_work_queue_start(&erase_workq, erase_workq_stack,
+                       K_THREAD_STACK_SIZEOF(erase_workq_stack),
+                       ERASE_WORKQ_PRIORITY, &workq_cfg);
+    k_work_init(&erase_work, spi_nand_erase_handler);
+    erase_workq_started = true;
+  }
 
+  chip_ready = true;
   LOG_INF("MT29F Init Complete");
 }
 
+bool mt29f_is_ready(void)
+{
+  return chip_ready;
+}
+
 int mt29f_read(const off_t offset, uint8_t *data, const size_t len)
 {
   if (!data) {
@@ -545,7 +2038,11 @@ int mt29f_read(const off_t offset, uint8_t *data, const size_t len)
     return -EINVAL;
   }
 
-  return spi_nand_page_read(offset, data, len);
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_page_read(offset, data, len);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
 }
 
 int mt29f_write(const off_t offset, const uint8_t *data, const size_t len)
@@ -560,18 +2057,308 @@ int mt29f_write(const off_t offset, const uint8_t *data, const size_t len)
     return -EINVAL;
   }
 
-  return spi_nand_page_write(offset, data, len);
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_pages_write(offset, data, len);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_write_parts(const off_t offset, const mt29f_part_t *parts, const size_t count,
+                      const uint8_t *oob, const size_t oob_len)
+{
+  mt29f_part_t all[MT29F_MAX_PARTS + 1];
+
+  if (!parts || count == 0 || count > MT29F_MAX_PARTS || oob_len > OOB_USER_BYTES) {
+    LOG_ERR("Invalid partial page write!");
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (!parts[i].data || parts[i].col + parts[i].len > inst.bytes_per_page) {
+      LOG_ERR("Part %d outside the page!", i);
+      return -EINVAL;
+    }
+    all[i] = parts[i];
+  }
+
+  size_t total = count;
+  if (oob) {
+    all[total++] = (mt29f_part_t) {
+      .col = inst.bytes_per_page - inst.oob_bytes + OOB_USER_POS,
+      .len = oob_len,
+      .data = oob
+    };
+  }
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_page_write_parts(offset - offset % inst.bytes_per_page, all, total, true);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_read_main(const off_t offset, uint8_t *data, const size_t len)
+{
+  const uint16_t main_bytes = inst.bytes_per_page - inst.oob_bytes;
+  const uint16_t col = offset % inst.bytes_per_page;
+
+  if (!data || col >= main_bytes) {
+    LOG_ERR("Invalid main area read!");
+    return -EINVAL;
+  }
+
+  if (len == 0) {
+    return 0;
+  }
+
+  const spi_nand_span_t s = {
+    .col = col,
+    .span = main_bytes,
+    .len = len
+  };
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_span_read(offset - col, data, s);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_program_main(const off_t offset, const uint8_t *data, const size_t len)
+{
+  int rc = 0;
+
+  const uint16_t main_bytes = inst.bytes_per_page - inst.oob_bytes;
+
+  if (!data || offset % inst.bytes_per_page != 0 || len % main_bytes != 0) {
+    LOG_ERR("Program main areas of whole pages!");
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  for (size_t done = 0, page = 0; done < len && rc == 0; done += main_bytes, page++) {
+    const mt29f_part_t part = {
+      .col = 0,
+      .len = main_bytes,
+      .data = &data[done]
+    };
+
+    rc = spi_nand_page_write_parts(offset + page * inst.bytes_per_page, &part, 1, false);
+  }
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
 }
 
 void mt29f_chip_erase(void)
 {
   LOG_INF("Erasing NAND chip...");
-  
-  for (int i = 0; i < inst.num_dies; i++) {
-    for (int j = 0; j < inst.blocks_per_die; j++) {
-      mt29f_row_addr_t addr = {.die_num = i, .blk_num = j, .page_num = 0};
-      spi_nand_block_erase(addr);
+
+  // Goes through the logical blocks so bad blocks are skipped and the bad block
+  // table itself is preserved. A blank check costs one tR against several ms of
+  // tBERS, so only blocks that hold data get erased.
+  uint32_t batch[CHIP_ERASE_BATCH];
+  size_t count = 0;
+  uint32_t erased = 0;
+
+  for (uint32_t lblock = 0; lblock < mt29f_get_num_blocks(); lblock++) {
+    k_mutex_lock(&nand_lock, K_FOREVER);
+
+    const mt29f_row_addr_t addr = spi_nand_block_to_row_addr(lblock);
+    if (spi_nand_block_is_erased(spi_nand_block_index(addr))) {
+      // already known erased
+    } else if (spi_nand_block_is_blank(lblock)) {
+      spi_nand_block_mark_erased(spi_nand_block_index(addr), true);
+    } else {
+      batch[count++] = lblock;
+    }
+
+    if (count == CHIP_ERASE_BATCH || (count > 0 && lblock + 1 == mt29f_get_num_blocks())) {
+      spi_nand_logical_blocks_erase(batch, count);
+      erased += count;
+      count = 0;
+    }
+
+    k_mutex_unlock(&nand_lock);
+  }
+  LOG_INF("Erase complete: %d blocks held data", erased);
+}
+
+int mt29f_oob_read(const off_t offset, uint8_t *data, const size_t len)
+{
+  if (!data || len > OOB_USER_BYTES) {
+    LOG_ERR("Invalid OOB read!");
+    return -EINVAL;
+  }
+
+  const mt29f_col_addr_t col = inst.bytes_per_page - inst.oob_bytes + OOB_USER_POS;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_page_read_at(spi_nand_offset_to_row_addr(offset), col, data, len);
+  if (rc == MT29F_ECC_REFRESH || rc == -EBADMSG) {
+    spi_nand_refresh_queue_add(offset / spi_nand_bytes_per_block());
+  }
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_oob_write(const off_t offset, const uint8_t *data, const size_t len)
+{
+  if (!data || len > OOB_USER_BYTES) {
+    LOG_ERR("Invalid OOB write!");
+    return -EINVAL;
+  }
+
+  const mt29f_col_addr_t col = inst.bytes_per_page - inst.oob_bytes + OOB_USER_POS;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_page_program(spi_nand_offset_to_row_addr(offset), col, data, len);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_erase_block(const off_t offset)
+{
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_logical_block_erase(offset / spi_nand_bytes_per_block());
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_erase_blocks(const uint32_t *blocks, const size_t count)
+{
+  if (!blocks) {
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (blocks[i] >= mt29f_get_num_blocks()) {
+      return -EINVAL;
     }
   }
-  LOG_INF("Erase complete");
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  int rc = spi_nand_logical_blocks_erase(blocks, count);
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_erase_block_async(const off_t offset)
+{
+  int rc = 0;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  if (erase_queue_count < ERASE_QUEUE_LEN) {
+    erase_queue[erase_queue_count++] = offset / spi_nand_bytes_per_block();
+  } else {
+    rc = -EBUSY;
+  }
+  k_mutex_unlock(&nand_lock);
+
+  if (rc == 0) {
+    k_work_submit_to_queue(&erase_workq, &erase_work);
+  }
+
+  return rc;
+}
+
+int mt29f_submit(mt29f_op_t *op)
+{
+  if (!op || (op->type != MT29F_OP_ERASE && !op->data)) {
+    return -EINVAL;
+  }
+
+  if (op->type == MT29F_OP_ERASE && op->offset / spi_nand_bytes_per_block() >= mt29f_get_num_blocks()) {
+    return -EINVAL;
+  }
+
+  if (!erase_workq_started) {
+    return -ENODEV;
+  }
+
+  k_work_init(&op->work, spi_nand_op_handler);
+
+  int rc = k_work_submit_to_queue(&erase_workq, &op->work);
+
+  return (rc < 0) ? rc : 0;
+}
+
+int mt29f_page_copy(const off_t src, const off_t dst, const uint8_t *oob, const size_t oob_len)
+{
+  if (oob_len > OOB_USER_BYTES) {
+    return -EINVAL;
+  }
+
+  const mt29f_col_addr_t col = inst.bytes_per_page - inst.oob_bytes + OOB_USER_POS;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+
+  const mt29f_row_addr_t src_addr = spi_nand_offset_to_row_addr(src);
+  const mt29f_row_addr_t dst_addr = spi_nand_offset_to_row_addr(dst);
+
+  int rc;
+  if (src_addr.die_num != dst_addr.die_num) {
+    // The cache register is per die, so there is no internal move across dies
+    rc = -EXDEV;
+  } else {
+    rc = spi_nand_page_move_patch(src_addr, dst_addr, col, oob, oob_len);
+  }
+
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+int mt29f_refresh_pop(uint32_t *block)
+{
+  int rc = -ENOENT;
+
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  if (refresh_queue_count > 0) {
+    *block = refresh_queue[0];
+    refresh_queue_count--;
+    memmove(&refresh_queue[0], &refresh_queue[1], refresh_queue_count * sizeof(refresh_queue[0]));
+    rc = 0;
+  }
+  k_mutex_unlock(&nand_lock);
+
+  return rc;
+}
+
+uint8_t mt29f_get_block_die(const uint32_t block)
+{
+  return block / spi_nand_logical_blocks_per_die();
+}
+
+uint32_t mt29f_get_num_blocks(void)
+{
+  return (uint32_t)inst.num_dies * spi_nand_logical_blocks_per_die();
+}
+
+off_t mt29f_get_size(void)
+{
+  return (off_t)mt29f_get_num_blocks() * spi_nand_bytes_per_block();
+}
+
+void mt29f_get_stats(mt29f_stats_t *out)
+{
+  k_mutex_lock(&nand_lock, K_FOREVER);
+  *out = stats;
+  k_mutex_unlock(&nand_lock);
+}
+
+int mt29f_get_bad_block_count(void)
+{
+  int count = 0;
+
+  for (size_t i = 0; i < ARRAY_SIZE(bbt.bad); i++) {
+    count += __builtin_popcount(bbt.bad[i]);
+  }
+
+  return count;
 }
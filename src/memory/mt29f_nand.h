@@ -6,6 +6,10 @@
 
 #include <sys/types.h>
 
+#include <zephyr/kernel.h>
+
+#include "mt29f_defs.h"
+
 typedef struct mt29f_cfg {
   uint8_t   num_dies;         // AKA "plane"
   uint16_t  blocks_per_die;
@@ -14,22 +18,228 @@ typedef struct mt29f_cfg {
   uint16_t  oob_bytes;
 } mt29f_cfg_t;
 
+/**
+ * @brief ECC outcome of a read, uncorrectable reads are reported as -EBADMSG instead
+*/
+typedef enum mt29f_ecc {
+  MT29F_ECC_CLEAN = 0,
+  MT29F_ECC_CORRECTED,        // 1-3 bit errors fixed
+  MT29F_ECC_REFRESH,          // 4-8 bit errors fixed, the block should be rewritten
+} mt29f_ecc_t;
+
+/**
+ * @brief Bus statistics, diff two snapshots to get the cost of an operation
+*/
+typedef struct mt29f_stats {
+  uint32_t spi_transactions;  // chip select cycles, one per command
+  uint32_t skipped_cmds;      // die selects, write enables and SET FEATUREs the shadow state made redundant
+  uint32_t status_polls;      // GET FEATURE(STATUS) reads while waiting on the array
+} mt29f_stats_t;
+
+/**
+ * @brief One piece of a page program: `len` bytes at column `col` (main or spare area)
+*/
+typedef struct mt29f_part {
+  uint16_t        col;
+  uint16_t        len;
+  const uint8_t  *data;
+} mt29f_part_t;
+
+// Most parts one mt29f_write_parts() call takes, not counting the OOB metadata
+#define MT29F_MAX_PARTS  4
+
+/**
+ * @brief Operations mt29f_submit() can run
+*/
+typedef enum mt29f_op_type {
+  MT29F_OP_READ,
+  MT29F_OP_WRITE,
+  MT29F_OP_ERASE,
+} mt29f_op_type_t;
+
+struct mt29f_op;
+
+typedef void (*mt29f_op_cb_t)(struct mt29f_op *op);
+
+/**
+ * @brief Asynchronous NAND operation, see mt29f_submit()
+ *
+ * @desc the op and its buffer belong to the driver from submit until completion
+*/
+typedef struct mt29f_op {
+  mt29f_op_type_t         type;
+  off_t                   offset;
+  uint8_t                *data;     // read destination or write source, unused for erase
+  size_t                  len;      // whole pages, unused for erase
+  mt29f_op_cb_t           cb;       // completion callback, runs on the driver work queue, may be NULL
+  struct k_poll_signal   *signal;   // raised with `result` on completion, may be NULL
+  int                     result;   // what the synchronous call would have returned
+
+  struct k_work           work;     // driver private
+} mt29f_op_t;
+
 /**
  * @brief This function initializes the flash device
 */
 void mt29f_init(const mt29f_cfg_t *cfg);
 
+/**
+ * @brief Whether mt29f_init() brought the chip up, so a second user can skip it
+*/
+bool mt29f_is_ready(void);
+
 /**
  * @brief Read data from flash device
+ *
+ * @desc `len` may span any number of whole pages. Multi-page reads are streamed
+ *       with cache-read mode so the array load of the next page overlaps with the
+ *       SPI transfer of the current one.
+ *
+ * @return the worst mt29f_ecc_t over all pages, -EBADMSG if a page stayed uncorrectable
+ *         after retries (its data is still copied out), or another negative error.
+ *         Blocks needing a refresh are queued, see mt29f_refresh_pop().
 */
 int mt29f_read(const off_t offset, uint8_t *data, const size_t len);
 
 /**
  * @brief Write data to flash device
+ *
+ * @desc `len` may span any number of whole pages. The first page of a block is only
+ *       erased inline if the background erase worker has not already erased it.
 */
 int mt29f_write(const off_t offset, const uint8_t *data, const size_t len);
 
+/**
+ * @brief Programs one page from several buffers without staging the page in RAM
+ *
+ * @desc the parts are loaded into the chip's cache register (PROGRAM LOAD, then PROGRAM
+ *       LOAD RANDOM DATA) and programmed together. Bytes no part covers stay 0xFF and
+ *       are never sent. Like mt29f_write(), page 0 of a block erases it if needed.
+ *
+ * @param oob       if not NULL, also programs the user OOB bytes of the page
+ *
+ * @return -EINVAL for more than MT29F_MAX_PARTS parts or a part outside the page
+*/
+int mt29f_write_parts(const off_t offset, const mt29f_part_t *parts, const size_t count,
+                      const uint8_t *oob, const size_t oob_len);
+
+/**
+ * @brief Reads main area bytes only, skipping the spare areas
+ *
+ * @desc `offset` is a page offset plus a column inside the main area. The bytes of
+ *       consecutive pages land back to back in `data`, streamed with cache-read mode
+ *       like mt29f_read(); `len` needs no page alignment.
+ *
+ * @return ECC status like mt29f_read()
+*/
+int mt29f_read_main(const off_t offset, uint8_t *data, const size_t len);
+
+/**
+ * @brief Programs the main areas of consecutive pages from a packed buffer
+ *
+ * @desc unlike mt29f_write() a block is never erased here: the pages must have been
+ *       erased with mt29f_erase_block() or mt29f_erase_blocks(). Spare areas stay 0xFF.
+ *
+ * @param offset    page aligned
+ * @param len       a multiple of the main area size
+*/
+int mt29f_program_main(const off_t offset, const uint8_t *data, const size_t len);
+
 /**
  * @brief Erases entire flash device
+ *
+ * @desc bad blocks and the stored bad block table are left alone. Blocks whose first
+ *       page is blank are skipped, so the time scales with the data written.
 */
 void mt29f_chip_erase(void);
+
+/**
+ * @brief Reads per-page metadata from the user part of the spare (OOB) area
+ *
+ * @param offset  any offset inside the page
+ * @param len     at most OOB_USER_BYTES
+ *
+ * @return ECC status like mt29f_read()
+*/
+int mt29f_oob_read(const off_t offset, uint8_t *data, const size_t len);
+
+/**
+ * @brief Programs per-page metadata into the user part of the spare (OOB) area
+ *
+ * @desc the main area bytes are left untouched (counts as one partial program of the page)
+*/
+int mt29f_oob_write(const off_t offset, const uint8_t *data, const size_t len);
+
+/**
+ * @brief Erases the block containing `offset`
+*/
+int mt29f_erase_block(const off_t offset);
+
+/**
+ * @brief Erases a list of logical blocks, interleaving erases on both dies
+ *
+ * @desc blocks the driver already knows to be erased are skipped
+*/
+int mt29f_erase_blocks(const uint32_t *blocks, const size_t count);
+
+/**
+ * @brief Queues the block containing `offset` for erase by the low priority erase worker
+ *
+ * @return -EBUSY if the erase queue is full
+*/
+int mt29f_erase_block_async(const off_t offset);
+
+/**
+ * @brief Queues `op` on the driver's low priority work queue and returns right away
+ *
+ * @desc reads and writes behave like mt29f_read() and mt29f_write(). An erase waits
+ *       out tBERS without holding the driver lock, so the other die and other
+ *       threads keep the bus meanwhile; a block that fails it is reported as -EIO
+ *       and retired by its next write. Completion calls `cb`, then raises `signal`.
+ *       An op must not be submitted again before it completed.
+ *
+ * @return -EINVAL for a missing buffer or a block out of range
+*/
+int mt29f_submit(mt29f_op_t *op);
+
+/**
+ * @brief Copies a page inside the chip (internal data move, no data crosses the SPI bus)
+ *
+ * @param oob       if not NULL, replaces the user OOB bytes of the copy
+ *
+ * @return -EXDEV if `src` and `dst` are on different dies
+*/
+int mt29f_page_copy(const off_t src, const off_t dst, const uint8_t *oob, const size_t oob_len);
+
+/**
+ * @brief Takes the oldest logical block that reported a refresh-recommended or
+ *        uncorrectable ECC status since the last call
+ *
+ * @return -ENOENT if no block is waiting
+*/
+int mt29f_refresh_pop(uint32_t *block);
+
+/**
+ * @brief Die that holds a logical block
+*/
+uint8_t mt29f_get_block_die(const uint32_t block);
+
+/**
+ * @brief Number of logical blocks (the reserved spare/BBT blocks are not included)
+*/
+uint32_t mt29f_get_num_blocks(void);
+
+/**
+ * @brief Size of the logical address space in bytes
+*/
+off_t mt29f_get_size(void);
+
+/**
+ * @brief Number of factory and grown bad blocks in the bad block table
+*/
+int mt29f_get_bad_block_count(void);
+
+/**
+ * @brief Snapshot of the bus statistics
+*/
+void mt29f_get_stats(mt29f_stats_t *stats);
@@ -11,15 +11,18 @@
 /* Standard C99 stuff */
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 
 /* Zephyr files */
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
 
 /* My header files  */
 #include <nvs.h>
 #include <mt29f_nand.h>
+#include <ftl.h>
 
 
 LOG_MODULE_REGISTER(nvs, LOG_LEVEL_INF);
@@ -39,11 +42,517 @@ static const mt29f_cfg_t cfg = {
 };
 
 
-#define TOTAL_PAGES cfg.num_dies * cfg.blocks_per_die * cfg.pages_per_block
+#define TOTAL_BLOCKS     (ftl_get_num_blocks())
+#define BYTES_PER_BLOCK  ((off_t)cfg.bytes_per_page * cfg.pages_per_block)
+#define TOTAL_BYTES      (ftl_get_size())
+
+#define NVS_PAGE_MAGIC   0x57574450  /* "WWDP" */
+#define NVS_ERASED_WORD  0xFFFFFFFF
 
 static off_t write_addr = 0;
 static off_t read_addr = 0;
 
+/* sequence number given to the next page appended to the log */
+static uint32_t next_seq = 0;
+
+BUILD_ASSERT(sizeof(nvs_page_hdr_t) == NVS_PAGE_HDR_SIZE, "NVS page header size mismatch");
+
+/*
+ * read cache: NVS_CACHE_PAGES raw log pages with CLOCK replacement. Slots are contiguous
+ * so a sequential miss can load the page after it into the next slot in one read.
+ */
+typedef struct nvs_cache_slot {
+    off_t addr;         // cached page address, -1 when empty
+    bool referenced;    // CLOCK bit, set when the page is read again
+    bool prefetched;    // loaded ahead of the reader and not read yet
+} nvs_cache_slot_t;
+
+static uint8_t cache_data[NVS_CACHE_PAGES][NVS_PAGE_SIZE];
+static nvs_cache_slot_t cache[NVS_CACHE_PAGES];
+static uint8_t cache_hand = 0;
+
+/* page a sequential reader would ask for next */
+static off_t cache_seq_next = -1;
+
+static nvs_cache_stats_t cache_stats;
+
+/* write path: records are packed into this payload until it is full or the deadline hits */
+static uint8_t append_page[NVS_PAGE_PAYLOAD];
+static size_t append_len = 0;
+
+static uint32_t commit_deadline_ms = NVS_COMMIT_DEADLINE_MS;
+static struct k_work_delayable commit_work;
+
+static K_MUTEX_DEFINE(nvs_lock);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * nvs_page_crc: CRC over the page header (minus the CRC field) and the used payload
+ */
+static uint32_t nvs_page_crc(const nvs_page_hdr_t *hdr, const uint8_t *payload)
+{
+    uint32_t crc = crc32_ieee((const uint8_t *)hdr, offsetof(nvs_page_hdr_t, crc));
+    return crc32_ieee_update(crc, payload, hdr->len);
+}
+
+
+/*
+ * nvs_page_is_programmed: true if the page at `addr` has ever been programmed
+ */
+static bool nvs_page_is_programmed(const nvs_page_hdr_t *hdr)
+{
+    return hdr->magic != NVS_ERASED_WORD;
+}
+
+
+/*
+ * nvs_page_is_valid: true if the page header and CRC check out
+ */
+static bool nvs_page_is_valid(const nvs_page_hdr_t *hdr, const uint8_t *payload)
+{
+    return hdr->magic == NVS_PAGE_MAGIC &&
+           hdr->len <= NVS_PAGE_PAYLOAD &&
+           hdr->crc == nvs_page_crc(hdr, payload);
+}
+
+
+/*
+ * nvs_page_payload: payload that follows a loaded page header
+ */
+static inline uint8_t *nvs_page_payload(nvs_page_hdr_t *hdr)
+{
+    return (uint8_t *)hdr + sizeof(nvs_page_hdr_t);
+}
+
+
+/*
+ * nvs_cache_find: slot holding the page at `addr`, or -1
+ */
+static int nvs_cache_find(off_t addr)
+{
+    for (uint8_t i = 0; i < NVS_CACHE_PAGES; i++) {
+        if (cache[i].addr == addr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/*
+ * nvs_cache_victim: CLOCK sweep, clearing reference bits until an unreferenced slot turns up
+ */
+static uint8_t nvs_cache_victim(void)
+{
+    for (;;) {
+        const uint8_t i = cache_hand;
+        cache_hand = (cache_hand + 1) % NVS_CACHE_PAGES;
+
+        if (cache[i].addr < 0 || !cache[i].referenced) {
+            return i;
+        }
+        cache[i].referenced = false;
+    }
+}
+
+
+/*
+ * nvs_cache_invalidate_from: drops cached pages of the block containing `addr`, from `addr` on
+ *
+ * Appending at `addr` programs that page, and when it is the first page of the block the
+ * FTL maps a freshly erased block under it, so every later page of the block changes too.
+ */
+static void nvs_cache_invalidate_from(off_t addr)
+{
+    const off_t block_end = addr - addr % BYTES_PER_BLOCK + BYTES_PER_BLOCK;
+
+    for (uint8_t i = 0; i < NVS_CACHE_PAGES; i++) {
+        if (cache[i].addr >= addr && cache[i].addr < block_end) {
+            cache[i].addr = -1;
+        }
+    }
+    if (cache_seq_next >= addr && cache_seq_next < block_end) {
+        cache_seq_next = -1;
+    }
+}
+
+
+/*
+ * nvs_cache_invalidate: drops the whole cache
+ */
+static void nvs_cache_invalidate(void)
+{
+    for (uint8_t i = 0; i < NVS_CACHE_PAGES; i++) {
+        cache[i].addr = -1;
+    }
+    cache_seq_next = -1;
+}
+
+
+/*
+ * nvs_load_page: gets one raw log page through the read cache
+ *
+ * `*hdr` stays valid until the next call. Pages only get their reference bit when read
+ * again, so a sequential pass does not push out the pages that are re-read (log head,
+ * segment headers). A miss right after the previous page was read also loads the page
+ * after it in the same cache-read run when the next slot is free to take it. Pages that
+ * fail ECC are handed back but not cached.
+ */
+static int nvs_load_page(off_t addr, nvs_page_hdr_t **hdr)
+{
+    int slot = nvs_cache_find(addr);
+
+    if (slot >= 0) {
+        cache_stats.hits++;
+
+        /* the first read of a prefetched page counts as its load, not as a re-use */
+        if (cache[slot].prefetched) {
+            cache_stats.prefetch_hits++;
+            cache[slot].prefetched = false;
+            cache_seq_next = addr + cfg.bytes_per_page;
+        } else {
+            cache[slot].referenced = true;
+        }
+        *hdr = (nvs_page_hdr_t *)cache_data[slot];
+        return 0;
+    }
+
+    cache_stats.misses++;
+    slot = nvs_cache_victim();
+
+    /* read ahead only inside the block, and not into the page being appended */
+    const off_t ahead = addr + cfg.bytes_per_page;
+    const bool prefetch = addr == cache_seq_next &&
+                          slot + 1 < NVS_CACHE_PAGES &&
+                          !cache[slot + 1].referenced &&
+                          ahead % BYTES_PER_BLOCK != 0 &&
+                          ahead != write_addr &&
+                          nvs_cache_find(ahead) < 0;
+    const uint8_t pages = prefetch ? 2 : 1;
+
+    for (uint8_t i = 0; i < pages; i++) {
+        cache[slot + i].addr = -1;
+    }
+
+    int rc = ftl_read(addr, cache_data[slot], (size_t)pages * cfg.bytes_per_page);
+    *hdr = (nvs_page_hdr_t *)cache_data[slot];
+
+    if (rc == 0) {
+        cache[slot].addr = addr;
+        cache[slot].referenced = false;
+        cache[slot].prefetched = false;
+
+        if (prefetch) {
+            cache[slot + 1].addr = ahead;
+            cache[slot + 1].referenced = false;
+            cache[slot + 1].prefetched = true;
+            cache_stats.prefetched++;
+
+            /* the hand must not sweep the page it was just filled with */
+            cache_hand = (slot + 2) % NVS_CACHE_PAGES;
+        }
+    }
+
+    cache_seq_next = prefetch ? -1 : ahead;
+    return rc;
+}
+
+
+/*
+ * nvs_block_is_head_side: binary search predicate over blocks
+ *
+ * The log is written block by block with strictly increasing sequence numbers, and
+ * wraps back to block 0 when the chip is full. Every block from 0 up to the head
+ * block therefore has its first page programmed with a sequence number >= that of
+ * block 0, and every block after it is either erased or holds older data.
+ */
+static bool nvs_block_is_head_side(uint32_t block, uint32_t first_seq)
+{
+    nvs_page_hdr_t *hdr;
+    if (nvs_load_page(block * BYTES_PER_BLOCK, &hdr) != 0) {
+        return false;
+    }
+
+    if (!nvs_page_is_programmed(hdr)) {
+        return false;
+    }
+
+    /* a torn first page can only belong to the block that was being written */
+    if (!nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+        return true;
+    }
+
+    return hdr->seq >= first_seq;
+}
+
+
+/*
+ * nvs_block_first_seq: sequence number of the first page in a block
+ */
+static bool nvs_block_first_seq(uint32_t block, uint32_t *seq)
+{
+    nvs_page_hdr_t *hdr;
+    if (nvs_load_page(block * BYTES_PER_BLOCK, &hdr) != 0) {
+        return false;
+    }
+
+    if (!nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+        return false;
+    }
+
+    *seq = hdr->seq;
+    return true;
+}
+
+
+/*
+ * nvs_block_pages_used: binary search for the number of programmed pages in a block
+ */
+static uint32_t nvs_block_pages_used(uint32_t block)
+{
+    uint32_t lo = 0;
+    uint32_t hi = cfg.pages_per_block;
+
+    /* pages are programmed in order, so "programmed" is true then false */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        nvs_page_hdr_t *hdr;
+        int rc = nvs_load_page(block * BYTES_PER_BLOCK + (off_t)mid * cfg.bytes_per_page, &hdr);
+
+        /* a page that does not read back cleanly is not safe to program over */
+        if (rc != 0 || nvs_page_is_programmed(hdr)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+
+/*
+ * nvs_set_head: puts the write head on the first free page of `head_block`
+ *
+ * The sequence number continues from the first page of the head block, or of the block
+ * before it. If neither is readable it is counted from `base_block`, whose first page
+ * had `base_seq`.
+ */
+static void nvs_set_head(uint32_t head_block, uint32_t base_block, uint32_t base_seq)
+{
+    /* short in-block probe for the first free page */
+    uint32_t pages_used = nvs_block_pages_used(head_block);
+    const uint32_t prev_block = (head_block + TOTAL_BLOCKS - 1) % TOTAL_BLOCKS;
+
+    uint32_t block_seq;
+    if (nvs_block_first_seq(head_block, &block_seq)) {
+        next_seq = block_seq + pages_used;
+    } else if (nvs_block_first_seq(prev_block, &block_seq)) {
+        next_seq = block_seq + cfg.pages_per_block + pages_used;
+    } else {
+        const uint32_t blocks_on = (head_block + TOTAL_BLOCKS - base_block) % TOTAL_BLOCKS;
+        next_seq = base_seq + blocks_on * cfg.pages_per_block + pages_used;
+    }
+
+    addr_offset = head_block * BYTES_PER_BLOCK + (off_t)pages_used * cfg.bytes_per_page;
+
+    /* head block is full: the next page starts the following block */
+    if (addr_offset >= TOTAL_BYTES) {
+        addr_offset = 0;
+    }
+}
+
+
+/*
+ * nvs_recover_from_checkpoint: finds the write head at or shortly after `head`, the
+ * append head recorded in the FTL checkpoint
+ *
+ * The FTL writes a new checkpoint before its erase pool runs out, so the log cannot
+ * have moved on by more than FTL_CKPT_POOL blocks. After a clean shutdown `head` is
+ * exact and two page reads confirm it. Returns false if the log does not match.
+ */
+static bool nvs_recover_from_checkpoint(off_t head)
+{
+    nvs_page_hdr_t *hdr;
+
+    /* a full log continues at the start */
+    head %= TOTAL_BYTES;
+
+    if (nvs_load_page(head, &hdr) != 0) {
+        return false;
+    }
+
+    if (!nvs_page_is_programmed(hdr)) {
+        /* nothing written since: the sequence continues from the page before */
+        const off_t prev = ((head == 0) ? TOTAL_BYTES : head) - cfg.bytes_per_page;
+        if (nvs_load_page(prev, &hdr) != 0) {
+            return false;
+        }
+
+        if (nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+            next_seq = hdr->seq + 1;
+        } else if (head == 0 && !nvs_page_is_programmed(hdr)) {
+            next_seq = 0;
+        } else {
+            return false;
+        }
+
+        addr_offset = head;
+        return true;
+    }
+
+    if (!nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+        return false;
+    }
+
+    /* pages written since the checkpoint all have a sequence number >= this one */
+    const uint32_t head_seq = hdr->seq;
+    const uint32_t base_block = head / BYTES_PER_BLOCK;
+    const uint32_t base_seq = head_seq - (head % BYTES_PER_BLOCK) / cfg.bytes_per_page;
+
+    uint32_t lo = 0;
+    uint32_t hi = MIN(FTL_CKPT_POOL, TOTAL_BLOCKS - 1);
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (nvs_block_is_head_side((base_block + mid) % TOTAL_BLOCKS, head_seq)) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    nvs_set_head((base_block + lo) % TOTAL_BLOCKS, base_block, base_seq);
+    return true;
+}
+
+
+/*
+ * nvs_program_page: programs `payload` as the next log page, behind a fresh header
+ *
+ * Header and payload go straight into the NAND cache register as two parts of one
+ * program; the unused tail of the page is never sent and stays erased.
+ *
+ * Caller must hold `nvs_lock`.
+ */
+static int nvs_program_page(uint16_t type, const uint8_t *payload, size_t len)
+{
+    nvs_page_hdr_t hdr = {
+        .magic = NVS_PAGE_MAGIC,
+        .seq = next_seq,
+        .len = len,
+        .flags = type,
+    };
+    hdr.crc = nvs_page_crc(&hdr, payload);
+
+    const mt29f_part_t parts[] = {
+        { .col = 0, .len = sizeof(hdr), .data = (const uint8_t *)&hdr },
+        { .col = sizeof(hdr), .len = len, .data = payload },
+    };
+    const size_t count = (len > 0) ? ARRAY_SIZE(parts) : 1;
+
+    nvs_cache_invalidate_from(ftl_append_get_head());
+    int status = ftl_append_parts(parts, count);
+
+    /* chip is full: wrap around and start overwriting the oldest blocks */
+    if (status == -ENOSPC) {
+        LOG_INF("NVS log wrapped");
+        ftl_append_start(0);
+        nvs_cache_invalidate_from(0);
+        status = ftl_append_parts(parts, count);
+    }
+
+    if (status == 0) {
+        next_seq++;
+    }
+
+    write_addr = ftl_append_get_head();
+    addr_offset = write_addr;
+
+    return status;
+}
+
+
+/*
+ * nvs_commit_page: programs the buffered records as one page
+ *
+ * Caller must hold `nvs_lock`.
+ */
+static int nvs_commit_page(uint16_t type)
+{
+    if (append_len == 0) {
+        return 0;
+    }
+
+    int status = nvs_program_page(type, append_page, append_len);
+    if (status == 0) {
+        append_len = 0;
+    }
+
+    return status;
+}
+
+
+/*
+ * nvs_append_locked: packs bytes into the append page, committing every full page
+ *
+ * Caller must hold `nvs_lock`.
+ */
+static int nvs_append_locked(const uint8_t *src, size_t len)
+{
+    int status = 0;
+
+    /* first bytes into an empty page start the commit deadline */
+    if (append_len == 0 && len > 0 && commit_deadline_ms > 0) {
+        k_work_schedule(&commit_work, K_MSEC(commit_deadline_ms));
+    }
+
+    while (len > 0) {
+        size_t chunk = MIN(len, NVS_PAGE_PAYLOAD - append_len);
+
+        memcpy(append_page + append_len, src, chunk);
+        append_len += chunk;
+        src += chunk;
+        len -= chunk;
+
+        if (append_len == NVS_PAGE_PAYLOAD) {
+            status = nvs_commit_page(NVS_PAGE_TYPE_LOG);
+            if (status != 0) {
+                return status;
+            }
+
+            if (len > 0 && commit_deadline_ms > 0) {
+                k_work_reschedule(&commit_work, K_MSEC(commit_deadline_ms));
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/*
+ * nvs_commit_deadline_handler: commits a partially filled page once its deadline passes
+ */
+static void nvs_commit_deadline_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    int status = nvs_commit_page(NVS_PAGE_TYPE_LOG);
+    k_mutex_unlock(&nvs_lock);
+
+    if (status != 0) {
+        LOG_ERR("NVS deadline commit failed: %d", status);
+    }
+}
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //! -----------------------------------------------------------------------------------------------------------------------//
@@ -51,76 +560,263 @@ static off_t read_addr = 0;
 //! -----------------------------------------------------------------------------------------------------------------------//
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void nvs_init(void)
+int nvs_init(void)
 {
-    mt29f_init(&cfg);
+    /* the flash device (mt29f_flash.c) may have brought the chip up at boot already */
+    if (!mt29f_is_ready()) {
+        mt29f_init(&cfg);
+    }
+
+    int rc = ftl_init(&cfg);
+    if (rc != 0) {
+        LOG_ERR("FTL init failed: %d", rc);
+        return rc;
+    }
+    k_work_init_delayable(&commit_work, nvs_commit_deadline_handler);
+    nvs_cache_invalidate();
+    memset(&cache_stats, 0, sizeof(cache_stats));
+
+    /* recover the write head near the checkpointed one, else from the log itself */
+    off_t ckpt_head;
+    if (ftl_get_checkpoint_head(&ckpt_head) && nvs_recover_from_checkpoint(ckpt_head)) {
+        LOG_INF("NVS head recovered at [%d], seq [%u] from checkpoint", addr_offset, next_seq);
+        offset_status = true;
+    } else {
+        offset_status = nvs_calc_offset();
+    }
+    write_addr = addr_offset;
+    ftl_append_start(write_addr);
+
+    return 0;
 }
 
 
 /*
- * nvs_write: performs a write on an NVS memory instance
+ * nvs_write: appends data to the log and commits it right away
  */
 int nvs_write(void * data, size_t len) {
-    int status = mt29f_write(write_addr, data, len);
-    write_addr += len;
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    int status = nvs_append_locked(data, len);
+    if (status == 0) {
+        status = nvs_commit_page(NVS_PAGE_TYPE_LOG);
+    }
+    k_mutex_unlock(&nvs_lock);
+
     return status;
 }
 
 
 /*
- * nvs_write_auto_offsets: performs a write operation with auto-increment of the "fresh space" offset
+ * nvs_append: buffers a (small) record; it reaches flash once a page fills, on
+ * nvs_sync() or when the commit deadline expires
  */
-int nvs_write_auto_offset(void * data, size_t len) {
-    // TODO: figure out how this gets going with my new MT29F config
-//     if (addr_offset > regionAttrs.regionSize) {
-//         return -1;
-//     }
+int nvs_append(const void * data, size_t len) {
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    int status = nvs_append_locked(data, len);
+    k_mutex_unlock(&nvs_lock);
+
+    return status;
+}
+
+
+/*
+ * nvs_sync: commits whatever is in the append page, even if it is not full
+ */
+int nvs_sync(void) {
+    k_work_cancel_delayable(&commit_work);
+
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    int status = nvs_commit_page(NVS_PAGE_TYPE_LOG);
+    k_mutex_unlock(&nvs_lock);
+
+    return status;
+}
+
+
+/*
+ * nvs_write_page: writes a payload as its own typed page, after any buffered records
+ */
+int nvs_write_page(const void * payload, size_t len, uint16_t type, off_t * addr) {
+    if (len > NVS_PAGE_PAYLOAD) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&nvs_lock, K_FOREVER);
 
-    int status = mt29f_write(addr_offset, data, len);
+    /* the payload is programmed from the caller's buffer, not copied into the append page */
+    int status = nvs_commit_page(NVS_PAGE_TYPE_LOG);
+    if (status == 0) {
+        status = nvs_program_page(type, payload, len);
+    }
+
+    if (status == 0 && addr) {
+        /* the head sits right behind the page just programmed */
+        *addr = write_addr - cfg.bytes_per_page;
+    }
 
-    addr_offset += len; // increment the offset up by 1
+    k_mutex_unlock(&nvs_lock);
     return status;
 }
 
 
 /*
- * nvs_read: performs a read on an NVS memory instance
+ * nvs_set_commit_deadline: sets how long a partial page may sit in RAM (0 = never auto-commit)
+ */
+void nvs_set_commit_deadline(uint32_t deadline_ms) {
+    commit_deadline_ms = deadline_ms;
+
+    if (deadline_ms == 0) {
+        k_work_cancel_delayable(&commit_work);
+    }
+}
+
+
+/*
+ * nvs_write_auto_offsets: performs a write operation with auto-increment of the "fresh space" offset
+ */
+int nvs_write_auto_offset(void * data, size_t len) {
+    /* the log always appends at the recovered head; small records get coalesced */
+    return nvs_append(data, len);
+}
+
+
+/*
+ * nvs_read: performs a raw read on an NVS memory instance, page by page through the cache
  */
 int nvs_read(void * buffer, size_t len, off_t addr) {
-    mt29f_read(addr, buffer, len);
+    uint8_t *out = buffer;
+    size_t left = len;
+    int status = 0;
+
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+
+    while (left > 0) {
+        const size_t in_page = addr % cfg.bytes_per_page;
+        const size_t run = MIN(left, cfg.bytes_per_page - in_page);
+
+        nvs_page_hdr_t *hdr;
+        int rc = nvs_load_page(addr - in_page, &hdr);
+        if (rc != 0) {
+            status = rc;
+            if (rc != -EBADMSG) {
+                break;
+            }
+        }
+
+        memcpy(out, (uint8_t *)hdr + in_page, run);
+        out += run;
+        addr += run;
+        left -= run;
+    }
+
+    k_mutex_unlock(&nvs_lock);
+
+    if (status != 0) {
+        return status;
+    }
     return len;
 }
 
 
 /*
- * nvs_get_offset: calculates the NVS address offset
+ * nvs_get_cache_stats: copies out the read cache counters
  */
-// TODO: this function needs to be redone with the new page constraint I have
-bool nvs_calc_offset() {
-    // look for unsigned int (0xFF / 255)
-    // if looking for int8_t will be looking for (-1)
-    uint8_t read_data[cfg.bytes_per_page];
+void nvs_get_cache_stats(nvs_cache_stats_t * stats) {
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    *stats = cache_stats;
+    k_mutex_unlock(&nvs_lock);
+}
 
 
-    // sweep whole region size
-    for (int page = 0; page < TOTAL_PAGES; page++) {
-        nvs_read(read_data, page, cfg.bytes_per_page); // data, offset, num bytes
+/*
+ * nvs_read_page: reads and validates one log page, copying out its payload
+ */
+int nvs_read_page(off_t addr, void * payload, size_t * len, uint32_t * seq, uint16_t * type) {
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+
+    nvs_page_hdr_t *hdr;
+    int status = nvs_load_page(addr, &hdr);
+    if (status == 0) {
+        if (!nvs_page_is_programmed(hdr)) {
+            status = -ENOENT;
+        } else if (!nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+            status = -EBADMSG;
+        } else {
+            memcpy(payload, nvs_page_payload(hdr), hdr->len);
+            *len = hdr->len;
+            if (seq) {
+                *seq = hdr->seq;
+            }
+            if (type) {
+                *type = hdr->flags;
+            }
+        }
+    }
 
-        // walk records inside page
-                /* Walk records inside page */
-        for (uint32_t r = 0; r < cfg.bytes_per_page; r++) {
-            uint8_t *rec = &read_data[r];
+    k_mutex_unlock(&nvs_lock);
+    return status;
+}
 
-            if (rec[0] == 0xFF &&
-                rec[1] == 0xFF &&
-                rec[2] == 0xFF) {
 
-                addr_offset = (page * cfg.bytes_per_page) + r;
-                return true;
+/*
+ * nvs_calc_offset: recovers the log write head
+ *
+ * Binary search over the first page of every block to find the newest block, then
+ * binary search inside that block for the first erased page. This costs
+ * O(log blocks + log pages) page reads instead of a full-chip scan.
+ */
+bool nvs_calc_offset() {
+    uint32_t first_seq;
+    uint32_t head_block;
+
+    /* nothing mounted, there is no log to search */
+    if (TOTAL_BLOCKS == 0) {
+        return false;
+    }
+
+    if (!nvs_block_first_seq(0, &first_seq)) {
+        nvs_page_hdr_t *hdr;
+        nvs_load_page(0, &hdr);
+
+        if (nvs_page_is_programmed(hdr)) {
+            /* block 0 holds a torn page; the head is somewhere in it */
+            first_seq = 0;
+        } else {
+            /*
+             * Block 0 is erased: either the chip is empty, or the log just wrapped
+             * and block 0 was erased ahead of the writer. In the second case the
+             * newest page is the last page of the chip.
+             */
+            addr_offset = 0;
+            next_seq = 0;
+
+            nvs_load_page(TOTAL_BYTES - cfg.bytes_per_page, &hdr);
+            if (nvs_page_is_valid(hdr, nvs_page_payload(hdr))) {
+                next_seq = hdr->seq + 1;
             }
+
+            LOG_INF("NVS head recovered at [%d], seq [%u]", addr_offset, next_seq);
+            return true;
         }
     }
-    return false;
+
+    /* find the last block for which the predicate holds */
+    uint32_t lo = 0;
+    uint32_t hi = TOTAL_BLOCKS - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (nvs_block_is_head_side(mid, first_seq)) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    head_block = lo;
+
+    nvs_set_head(head_block, 0, first_seq);
+
+    LOG_INF("NVS head recovered at [%d], seq [%u]", addr_offset, next_seq);
+    return true;
 }
 
 
@@ -136,8 +832,15 @@ int nvs_get_addr_offset() {
  * nvs_get_region_size: gets the region size of the NVS
  */
 size_t nvs_get_region_size() {
-    // NVS_getAttrs(nvsHandle, &regionAttrs);
-    // return regionAttrs.regionSize;
+    return TOTAL_BYTES;
+}
+
+
+/*
+ * nvs_get_block_size: gets the size of one erase block of the log
+ */
+size_t nvs_get_block_size() {
+    return BYTES_PER_BLOCK;
 }
 
 
@@ -148,13 +851,21 @@ size_t nvs_get_region_size() {
  * nvs_erase_region: erases the whole NVS region
  */
 void nvs_erase_region() {
-    LOG_INFO("Erasing flash REGION... like the whole thing...\n");
+    LOG_INF("Erasing flash REGION... like the whole thing...\n");
 
-    mt29f_chip_erase();
+    k_mutex_lock(&nvs_lock, K_FOREVER);
+    k_work_cancel_delayable(&commit_work);
+    append_len = 0;
+    ftl_format();
+    nvs_cache_invalidate();
 
     // regenerate the address offset
     nvs_calc_offset();
-    LOG_INFO("\tnew write offset set at: [%d]", addr_offset);
+    write_addr = addr_offset;
+    ftl_append_start(write_addr);
+    k_mutex_unlock(&nvs_lock);
+
+    LOG_INF("\tnew write offset set at: [%d]", addr_offset);
 }
 
 
@@ -164,6 +875,10 @@ void nvs_erase_region() {
  */
 void nvs_close() {
     // NVS_close(nvsHandle);
+    nvs_sync();
+
+    /* lets the next boot mount without replaying anything */
+    ftl_checkpoint();
 }
 
 
@@ -13,21 +13,69 @@
 
 
 /* Standard C99 stuff */
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <sys/types.h>
 
 
+/* log page geometry: one MT29F page, of which only the main area carries log data */
+#define NVS_PAGE_SIZE       2176
+#define NVS_PAGE_DATA_SIZE  2048
+#define NVS_PAGE_HDR_SIZE   16
+#define NVS_PAGE_PAYLOAD    (NVS_PAGE_DATA_SIZE - NVS_PAGE_HDR_SIZE)
+
+/* default time a partially filled append page may wait in RAM before it is committed */
+#define NVS_COMMIT_DEADLINE_MS  5000
+
+/* raw pages kept by the read cache (NVS_PAGE_SIZE bytes of RAM each); 1 disables read-ahead */
+#ifndef NVS_CACHE_PAGES
+#define NVS_CACHE_PAGES         2
+#endif
+
+/* page types, kept in the `flags` field of the page header */
+#define NVS_PAGE_TYPE_LOG      0xFFFF  // records packed by nvs_append()/nvs_write()
+#define NVS_PAGE_TYPE_ARCHIVE  0x0001  // one time-series archive segment (archive.c)
+
+
+/**
+ * @brief header at the start of every page in the log
+ */
+typedef struct nvs_page_hdr {
+    uint32_t magic;     // NVS_PAGE_MAGIC once programmed, 0xFFFFFFFF when erased
+    uint32_t seq;       // monotonically increasing per appended page
+    uint16_t len;       // payload bytes used in this page
+    uint16_t flags;     // page type (NVS_PAGE_TYPE_*)
+    uint32_t crc;       // CRC32 over the header fields above and the used payload
+} __attribute__((packed)) nvs_page_hdr_t;
+
+
+/**
+ * @brief read cache counters since nvs_init(); diff two snapshots to measure a workload
+ */
+typedef struct nvs_cache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t prefetched;      // pages loaded ahead of a sequential reader
+    uint32_t prefetch_hits;   // prefetched pages that were read before being evicted
+} nvs_cache_stats_t;
+
+
 
 /**
  * @brief initializes the NVS handle
+ *
+ * @return 0 on success, the FTL error if the flash could not be mounted (no other NVS call is valid then)
  */
-void nvs_init();
+int nvs_init();
 
 
 
 /*
  * @brief close the NVS handle
+ *
+ * @desc commits buffered records and writes an FTL checkpoint, so the next boot mounts
+ *       without any recovery scan. Call before a clean shutdown.
  */
 void nvs_close();
 
@@ -35,7 +83,8 @@ void nvs_close();
 /**
  * @brief calculates address offset
  *
- * @desc reads through flash memory until sequence of 0xFF is found
+ * @desc recovers the log write head with a binary search over blocks followed by a
+ *       short probe inside the newest block
  */
 bool nvs_calc_offset();
 
@@ -52,24 +101,92 @@ int nvs_get_addr_offset();
 size_t nvs_get_region_size();
 
 
+/**
+ * @brief size of one erase block of the log in bytes (a whole number of pages)
+ */
+size_t nvs_get_block_size();
+
+
 /**
  * @brief performs an NVS write
+ *
+ * @desc appends `len` bytes to the log (after anything already buffered) and commits
+ *       it right away
  */
 int nvs_write(void * data, size_t len);
 
 
 /**
  * @brief performs an NVS write at calculated "fresh address offset"
+ *
+ * @desc goes through the append buffer, so tiny records are coalesced into pages
  */
 int nvs_write_auto_offset(void * data, size_t num_bytes);
 
 
+/**
+ * @brief buffers a record in RAM and packs it into the next log page
+ *
+ * @desc the page is programmed once it is full, on nvs_sync(), or when the commit
+ *       deadline expires
+ */
+int nvs_append(const void * data, size_t len);
+
+
+/**
+ * @brief writes `len` bytes as a page of their own, tagged with a page type
+ *
+ * @desc records still buffered by nvs_append() are committed first, so the page never
+ *       mixes with plain log data
+ *
+ * @param[in]   payload   at most NVS_PAGE_PAYLOAD bytes
+ * @param[in]   len       payload length
+ * @param[in]   type      page type (NVS_PAGE_TYPE_*)
+ * @param[out]  addr      flash address the page landed at (may be NULL)
+ */
+int nvs_write_page(const void * payload, size_t len, uint16_t type, off_t * addr);
+
+
+/**
+ * @brief commits the partially filled append page to flash
+ */
+int nvs_sync(void);
+
+
+/**
+ * @brief sets the commit deadline for buffered records
+ *
+ * @param[in]   deadline_ms   max time a buffered record may wait in RAM, 0 disables
+ */
+void nvs_set_commit_deadline(uint32_t deadline_ms);
+
+
 /**
  * @brief reads the NVS
  */
 int nvs_read(void * buffer, size_t len, off_t addr);
 
 
+/**
+ * @brief reads one log page and validates its header
+ *
+ * @param[in]   addr      page aligned flash address
+ * @param[out]  payload   buffer of at least NVS_PAGE_PAYLOAD bytes
+ * @param[out]  len       number of payload bytes in the page
+ * @param[out]  seq       page sequence number (may be NULL)
+ * @param[out]  type      page type (may be NULL)
+ *
+ * @return 0 on success, -ENOENT for an erased page, -EBADMSG on a CRC mismatch
+ */
+int nvs_read_page(off_t addr, void * payload, size_t * len, uint32_t * seq, uint16_t * type);
+
+
+/**
+ * @brief copies out the read cache counters
+ */
+void nvs_get_cache_stats(nvs_cache_stats_t * stats);
+
+
 /**
  * @brief erases the whole NVS region
  */
@@ -0,0 +1,137 @@
+//*****************************************************************************
+//!
+//! @file main.c
+//! @author Anders Bandt
+//! @brief Render vs. SPI transfer overlap of the ST7735S band flush
+//! @version 0.9
+//! @date October 2026
+//!
+//! Build and flash (needs the panel, times are real bus times):
+//!     west build -b 96b_nitrogen test/display_bench && west flash
+//!
+//! Every scene is drawn with blocking transfers and with async ones. The bus
+//! time the UI thread did not spend blocked ran while the next band was drawn.
+//!
+//*****************************************************************************
+
+/* standard C file */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+/* My driver files */
+#include "st7735s.h"
+#include "gfx.h"
+#include "fonts.h"
+
+
+LOG_MODULE_REGISTER(display_bench, LOG_LEVEL_INF);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL VARIABLES ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_FRAMES    20
+
+typedef void (*scene_t)(uint32_t frame);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* scene_fill: whole screen in one color, the most bus time per frame */
+static void scene_fill(uint32_t frame)
+{
+    setColor(frame % 32, (2 * frame) % 64, 31 - frame % 32);
+    filledRect(0, 0, WIDTH - 1, HEIGHT - 1);
+}
+
+
+/* scene_text: a page of opaque text lines on a cleared screen */
+static void scene_text(uint32_t frame)
+{
+    char line[24];
+
+    setColor(0, 0, 0);
+    filledRect(0, 0, WIDTH - 1, HEIGHT - 1);
+
+    setFont(ter_u12b);
+    setTransparent(false);
+    setColor(31, 63, 31);
+    setbgColor(0, 0, 8);
+    for (uint16_t i = 0; i < 12; i++) {
+        snprintf(line, sizeof(line), "line %2d frame %3d", i, frame);
+        drawText(2, 2 + i * 14, line);
+    }
+}
+
+
+/* scene_widgets: two small status fields, the usual UI update */
+static void scene_widgets(uint32_t frame)
+{
+    char text[12];
+
+    setFont(ter_u12b);
+    setTransparent(false);
+    setColor(31, 63, 31);
+    setbgColor(0, 0, 0);
+    snprintf(text, sizeof(text), "%02d:%02d", frame / 60, frame % 60);
+    drawText(4, 4, text);
+    snprintf(text, sizeof(text), "%3d%%", 100 - frame);
+    drawText(WIDTH - 40, HEIGHT - 16, text);
+}
+
+
+/*
+ * bench_scene: draws and flushes a scene BENCH_FRAMES times with and without async transfers
+ */
+static void bench_scene(const char *name, scene_t scene)
+{
+    for (int async = 0; async <= 1; async++) {
+        SPI_asyncEnable(async);
+        spi_stats = (spi_stats_t){ 0 };
+
+        uint32_t t0 = k_cycle_get_32();
+        for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+            scene(frame);
+            flushBuffer();
+        }
+        SPI_wait();
+        uint32_t cycles = k_cycle_get_32() - t0;
+
+        const uint32_t frame_us = k_cyc_to_us_floor32(cycles / BENCH_FRAMES);
+        const uint32_t bus_us = k_cyc_to_us_floor32(spi_stats.bus_cycles / BENCH_FRAMES);
+        const uint32_t wait_us = k_cyc_to_us_floor32(spi_stats.wait_cycles / BENCH_FRAMES);
+        const uint32_t hidden_us = (bus_us > wait_us) ? bus_us - wait_us : 0;
+
+        LOG_INF("%-8s %-8s frame %6d us: bus %6d us, UI blocked %6d us, drawing %6d us, overlap %3d%% of bus time, %d transfers",
+                name, async ? "async" : "blocking", frame_us, bus_us, wait_us, frame_us - MIN(wait_us, frame_us),
+                bus_us ? hidden_us * 100 / bus_us : 0, spi_stats.transfers / BENCH_FRAMES);
+    }
+}
+
+
+int main(void)
+{
+    ST7735S_Init();
+    setOrientation(R0);
+
+    LOG_INF("ST7735S %dx%d, %d frames per scene", WIDTH, HEIGHT, BENCH_FRAMES);
+
+    bench_scene("fill", scene_fill);
+    bench_scene("text", scene_text);
+    bench_scene("widgets", scene_widgets);
+
+    LOG_INF("Done");
+    return 0;
+}
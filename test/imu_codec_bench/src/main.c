@@ -0,0 +1,230 @@
+//*****************************************************************************
+//!
+//! @file main.c
+//! @author Anders Bandt
+//! @brief Compression ratio and throughput of the IMU flash codec
+//! @version 0.9
+//! @date October 2026
+//!
+//! Build and run on the host, or flash it to get real cycle counts:
+//!     west build -b native_sim test/imu_codec_bench && west build -t run
+//!     west build -b 96b_nitrogen test/imu_codec_bench && west flash
+//!
+//! A recorded trace can be dropped in as src/imu_trace.inc: a comma separated list
+//! of imu_sample_t initializers ({{ax, ay, az}, {gx, gy, gz}, temp}) at IMU_ODR_HZ.
+//! Without one, the bench synthesizes rest, walking and shaking traces that follow
+//! the ICM-42670 scaling used by the app (+-16 g, +-2000 dps).
+//!
+//*****************************************************************************
+
+/* standard C file */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+/* My driver files */
+#include <imu_codec.h>
+
+
+LOG_MODULE_REGISTER(imu_codec_bench, LOG_LEVEL_INF);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL VARIABLES ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_ODR_HZ        100
+#define BENCH_SECONDS       600
+#define BENCH_SAMPLES       (BENCH_ODR_HZ * BENCH_SECONDS)
+
+/* what the logger would store per sample without the codec: 7 channels + 16 bit timestamp */
+#define RAW_SAMPLE_BYTES    16
+
+#define LSB_PER_G           2048
+#define LSB_PER_DPS         16
+
+#define PI                  3.14159265f
+
+typedef enum {
+    TRACE_REST,
+    TRACE_WALK,
+    TRACE_SHAKE,
+    TRACE_RECORDED,
+    TRACE_COUNT
+} trace_t;
+
+static const char *trace_names[TRACE_COUNT] = {
+    "rest",
+    "walk",
+    "shake",
+    "recorded"
+};
+
+#if __has_include("imu_trace.inc")
+static const imu_sample_t recorded_trace[] = {
+#include "imu_trace.inc"
+};
+#define HAVE_RECORDED_TRACE 1
+#define RECORDED_SAMPLES    ARRAY_SIZE(recorded_trace)
+#else
+#define HAVE_RECORDED_TRACE 0
+#define RECORDED_SAMPLES    0
+#endif
+
+static uint32_t rng = 1;
+
+static imu_codec_enc_t enc;
+static imu_sample_t in[IMU_CODEC_BLOCK_SAMPLES];
+static imu_sample_t out[IMU_CODEC_BLOCK_SAMPLES];
+static uint8_t block[IMU_CODEC_MAX_BLOCK_BYTES];
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* noise: uniform sensor noise in [-amp, amp] LSB */
+static int16_t noise(int32_t amp)
+{
+    rng = rng * 1664525 + 1013904223;
+    return (int16_t)((int32_t)((rng >> 8) % (uint32_t)(2 * amp + 1)) - amp);
+}
+
+
+static int16_t clamp16(int32_t v)
+{
+    return (int16_t)CLAMP(v, INT16_MIN, INT16_MAX);
+}
+
+
+/*
+ * trace_sample: sample `i` of a trace, `s` holds sample i - 1 on entry
+ */
+static void trace_sample(trace_t trace, uint32_t i, imu_sample_t *s)
+{
+    const float t = (float)i / BENCH_ODR_HZ;
+    const float gait = 2 * PI * 1.8f * t;
+
+    switch (trace) {
+    case TRACE_REST:
+        /* flat on a table: gravity on z, a few LSB of noise, slow temperature drift */
+        s->accel[0] = noise(4);
+        s->accel[1] = noise(4);
+        s->accel[2] = LSB_PER_G + noise(4);
+        s->gyro[0] = noise(3);
+        s->gyro[1] = noise(3);
+        s->gyro[2] = noise(3);
+        s->temperature = 3200 + i / 6000;
+        break;
+
+    case TRACE_WALK:
+        /* wrist at 1.8 steps/s */
+        s->accel[0] = clamp16(0.3f * LSB_PER_G * sinf(gait) + noise(12));
+        s->accel[1] = clamp16(0.1f * LSB_PER_G * sinf(2 * gait) + noise(12));
+        s->accel[2] = clamp16(LSB_PER_G + 0.5f * LSB_PER_G * sinf(gait + 0.6f) + noise(12));
+        s->gyro[0] = clamp16(90.0f * LSB_PER_DPS * sinf(gait + 1.0f) + noise(8));
+        s->gyro[1] = clamp16(40.0f * LSB_PER_DPS * sinf(2 * gait) + noise(8));
+        s->gyro[2] = clamp16(25.0f * LSB_PER_DPS * sinf(gait) + noise(8));
+        s->temperature = 3400 + i / 3000;
+        break;
+
+    case TRACE_SHAKE:
+        /* vigorous, mostly unpredictable motion */
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            s->accel[axis] = clamp16(s->accel[axis] + noise(LSB_PER_G / 4));
+            s->gyro[axis] = clamp16(s->gyro[axis] + noise(100 * LSB_PER_DPS));
+        }
+        s->temperature = 3400 + noise(2);
+        break;
+
+    case TRACE_RECORDED:
+    default:
+#if HAVE_RECORDED_TRACE
+        *s = recorded_trace[i % RECORDED_SAMPLES];
+#endif
+        break;
+    }
+}
+
+
+/*
+ * bench_trace: encodes and decodes a trace block by block, checking every sample
+ */
+static void bench_trace(trace_t trace)
+{
+    const uint32_t samples = (trace == TRACE_RECORDED) ? RECORDED_SAMPLES : BENCH_SAMPLES;
+
+    uint64_t enc_cycles = 0;
+    uint64_t dec_cycles = 0;
+    uint64_t bytes = 0;
+    uint32_t errors = 0;
+    imu_sample_t sample = { 0 };
+
+    imu_codec_enc_init(&enc, BENCH_ODR_HZ);
+    rng = 1;
+
+    for (uint32_t first = 0; first < samples; first += IMU_CODEC_BLOCK_SAMPLES) {
+        const uint32_t n = MIN(IMU_CODEC_BLOCK_SAMPLES, samples - first);
+
+        for (uint32_t i = 0; i < n; i++) {
+            trace_sample(trace, first + i, &sample);
+            in[i] = sample;
+        }
+
+        uint32_t t0 = k_cycle_get_32();
+        size_t len = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            len = imu_codec_enc_push(&enc, &in[i], block);
+        }
+        if (n < IMU_CODEC_BLOCK_SAMPLES) {
+            len = imu_codec_enc_flush(&enc, block);
+        }
+        uint32_t t1 = k_cycle_get_32();
+        int decoded = imu_codec_decode(block, len, out, NULL);
+        uint32_t t2 = k_cycle_get_32();
+
+        enc_cycles += t1 - t0;
+        dec_cycles += t2 - t1;
+        bytes += len;
+
+        if (decoded != (int)n || memcmp(in, out, n * sizeof(imu_sample_t)) != 0) {
+            errors++;
+        }
+    }
+
+    const uint64_t enc_ns = k_cyc_to_ns_floor64(enc_cycles);
+    const uint64_t dec_ns = k_cyc_to_ns_floor64(dec_cycles);
+
+    LOG_INF("%-8s %6d samples: %3d.%02dx, %2d.%02d B/sample, encode %5d ns/sample, decode %5d ns/sample, %d bad blocks",
+            trace_names[trace], samples,
+            (uint32_t)((uint64_t)samples * RAW_SAMPLE_BYTES * 100 / bytes) / 100,
+            (uint32_t)((uint64_t)samples * RAW_SAMPLE_BYTES * 100 / bytes) % 100,
+            (uint32_t)(bytes * 100 / samples) / 100, (uint32_t)(bytes * 100 / samples) % 100,
+            (uint32_t)(enc_ns / samples), (uint32_t)(dec_ns / samples), errors);
+}
+
+
+int main(void)
+{
+    LOG_INF("IMU codec: %d samples per block, raw baseline %d B/sample", IMU_CODEC_BLOCK_SAMPLES, RAW_SAMPLE_BYTES);
+
+    for (trace_t trace = 0; trace < TRACE_COUNT; trace++) {
+        if (trace == TRACE_RECORDED && RECORDED_SAMPLES == 0) {
+            LOG_INF("no recorded trace (src/imu_trace.inc), skipping");
+            continue;
+        }
+        bench_trace(trace);
+    }
+
+    LOG_INF("Done");
+    return 0;
+}
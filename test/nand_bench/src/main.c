@@ -0,0 +1,651 @@
+//*****************************************************************************
+//!
+//! @file main.c
+//! @author Anders Bandt
+//! @brief Storage benchmarks for the MT29F driver, FTL and NVS log on native_sim
+//! @version 0.9
+//! @date October 2026
+//!
+//! Build and run (the emulated array needs the 64 bit target):
+//!     west build -b native_sim/native/64 test/nand_bench
+//!     west build -t run
+//!
+//! All times are simulated time: the emulator charges SPI bus time per transfer
+//! and models tR/tPROG/tBERS through the OIP bit, so results do not depend on
+//! the host machine.
+//!
+//*****************************************************************************
+
+/* standard C file */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Zephyr files */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/emul.h>
+
+/* My driver files */
+#include <mt29f_nand.h>
+#include <mt29f_emul.h>
+#include <ftl.h>
+#include <nvs.h>
+
+
+LOG_MODULE_REGISTER(nand_bench, LOG_LEVEL_INF);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! GLOBAL VARIABLES ------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* same geometry as nvs.c */
+static const mt29f_cfg_t cfg = {
+    .num_dies = 2,
+    .blocks_per_die = 1024,
+    .pages_per_block = 64,
+    .bytes_per_page = 2176,
+    .oob_bytes = 128
+};
+
+#define BENCH_PAGES          64      // pages per throughput run (one block)
+#define BENCH_FORMAT_BLOCKS  100     // blocks written before the format benchmark
+#define BENCH_ENDURANCE_LAPS 3       // full passes over the FTL address space
+#define BENCH_LOG_PAGES      256     // log pages read back by the NVS cache benchmark
+#define BENCH_RECORD_BYTES   200     // payload of a partly filled log page
+#define BENCH_CUT_BLOCKS     8       // virtual blocks written before each power cut
+#define BENCH_CUT_VBLOCK     3       // the one whose refresh move loses power
+
+static const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(mt29f));
+
+static uint8_t buf[BENCH_PAGES * 2176];
+
+static uint32_t bench_failures = 0;
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//! -----------------------------------------------------------------------------------------------------------------------//
+//! LOCAL FUNCTIONS -------------------------------------------------------------------------------------------------------//
+//! -----------------------------------------------------------------------------------------------------------------------//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t bench_now_us(void)
+{
+    return k_cyc_to_us_floor64(k_cycle_get_64());
+}
+
+
+static uint32_t bench_kbps(size_t bytes, uint64_t us)
+{
+    return us ? (uint32_t)(((uint64_t)bytes * 1000000 / us) / 1024) : 0;
+}
+
+
+static uint8_t bench_pattern(size_t i, uint32_t seed)
+{
+    return (uint8_t)(i * 31 + seed);
+}
+
+
+static void bench_fill(uint32_t seed)
+{
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = bench_pattern(i, seed);
+    }
+}
+
+
+/*
+ * bench_check: logs and counts a failed call, reads are expected clean since no bit errors are injected
+ */
+static void bench_check(const char *what, int rc)
+{
+    if (rc != 0) {
+        LOG_ERR("%s failed: %d", what, rc);
+        bench_failures++;
+    }
+}
+
+
+/*
+ * bench_verify: compares data read back from flash offset `offset` with what was written there
+ */
+static void bench_verify(const char *what, off_t offset, const uint8_t *expect, const uint8_t *got, size_t len)
+{
+    if (memcmp(expect, got, len) == 0) {
+        return;
+    }
+
+    size_t i = 0;
+    while (expect[i] == got[i]) {
+        i++;
+    }
+    LOG_ERR("%s: mismatch at 0x%08lx, wrote 0x%02x, read 0x%02x", what, (long)(offset + i), expect[i], got[i]);
+    bench_failures++;
+}
+
+
+/*
+ * bench_verify_fill: like bench_verify() against the bench_fill() pattern, `index` is the buffer position of `got`
+ */
+static void bench_verify_fill(const char *what, off_t offset, uint32_t seed, size_t index, const uint8_t *got, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (got[i] != bench_pattern(index + i, seed)) {
+            LOG_ERR("%s: mismatch at 0x%08lx, wrote 0x%02x, read 0x%02x", what, (long)(offset + i),
+                    bench_pattern(index + i, seed), got[i]);
+            bench_failures++;
+            return;
+        }
+    }
+}
+
+
+/*
+ * bench_read_modes: page-by-page reads against one cache-read stream
+ */
+static void bench_read_modes(void)
+{
+    int rc = 0;
+
+    bench_fill(1);
+    bench_check("erase", mt29f_erase_block(0));
+    bench_check("write", mt29f_write(0, buf, sizeof(buf)));
+
+    memset(buf, 0, sizeof(buf));
+    uint64_t t0 = bench_now_us();
+    for (size_t page = 0; page < BENCH_PAGES; page++) {
+        rc |= mt29f_read(page * cfg.bytes_per_page, &buf[page * cfg.bytes_per_page], cfg.bytes_per_page);
+    }
+    uint64_t single_us = bench_now_us() - t0;
+    bench_check("page by page read", rc);
+    bench_verify_fill("page by page read", 0, 1, 0, buf, sizeof(buf));
+
+    memset(buf, 0, sizeof(buf));
+    t0 = bench_now_us();
+    rc = mt29f_read(0, buf, sizeof(buf));
+    uint64_t stream_us = bench_now_us() - t0;
+    bench_check("cache-read", rc);
+    bench_verify_fill("cache-read", 0, 1, 0, buf, sizeof(buf));
+
+    LOG_INF("read  page by page: %6d KB/s", bench_kbps(sizeof(buf), single_us));
+    LOG_INF("read  cache-read:   %6d KB/s", bench_kbps(sizeof(buf), stream_us));
+}
+
+
+/*
+ * bench_bus_widths: read/program throughput for x1, x2 and x4 data phases
+ */
+static void bench_bus_widths(void)
+{
+    static const uint8_t widths[] = {1, 2, 4};
+
+    for (size_t i = 0; i < ARRAY_SIZE(widths); i++) {
+        /* the driver probes the widest mode at init and falls back to what the bus takes */
+        mt29f_emul_set_max_lines(emul, widths[i]);
+        mt29f_init(&cfg);
+
+        bench_fill(widths[i]);
+        mt29f_erase_block(0);
+
+        uint64_t t0 = bench_now_us();
+        mt29f_write(0, buf, sizeof(buf));
+        uint64_t write_us = bench_now_us() - t0;
+
+        t0 = bench_now_us();
+        mt29f_read(0, buf, sizeof(buf));
+        uint64_t read_us = bench_now_us() - t0;
+
+        LOG_INF("x%d: read %6d KB/s, write %6d KB/s", widths[i],
+                bench_kbps(sizeof(buf), read_us), bench_kbps(sizeof(buf), write_us));
+    }
+
+    mt29f_emul_set_max_lines(emul, 1);
+    mt29f_init(&cfg);
+}
+
+
+/*
+ * bench_transactions: chip select cycles per operation (status polls included)
+ */
+static void bench_transactions(void)
+{
+    mt29f_stats_t before, after;
+
+    mt29f_get_stats(&before);
+    mt29f_erase_block(0);
+    mt29f_get_stats(&after);
+    LOG_INF("block erase: %d transactions, %d skipped, %d status polls",
+            after.spi_transactions - before.spi_transactions, after.skipped_cmds - before.skipped_cmds,
+            after.status_polls - before.status_polls);
+
+    before = after;
+    mt29f_write(0, buf, cfg.bytes_per_page);
+    mt29f_get_stats(&after);
+    LOG_INF("page write:  %d transactions, %d skipped, %d status polls",
+            after.spi_transactions - before.spi_transactions, after.skipped_cmds - before.skipped_cmds,
+            after.status_polls - before.status_polls);
+
+    before = after;
+    mt29f_read(0, buf, cfg.bytes_per_page);
+    mt29f_get_stats(&after);
+    LOG_INF("page read:   %d transactions, %d skipped, %d status polls",
+            after.spi_transactions - before.spi_transactions, after.skipped_cmds - before.skipped_cmds,
+            after.status_polls - before.status_polls);
+}
+
+
+/*
+ * bench_async: an erase through mt29f_submit() while the caller sleeps on its k_poll signal
+ */
+static void bench_async(void)
+{
+    struct k_poll_signal done;
+    struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &done);
+    mt29f_op_t op = {
+        .type = MT29F_OP_ERASE,
+        .offset = 0,
+        .signal = &done
+    };
+    mt29f_stats_t before, after;
+
+    k_poll_signal_init(&done);
+    mt29f_write(0, buf, cfg.bytes_per_page);
+
+    mt29f_get_stats(&before);
+    uint64_t t0 = bench_now_us();
+    int rc = mt29f_submit(&op);
+    if (rc == 0) {
+        k_poll(&event, 1, K_FOREVER);
+    }
+    uint64_t erase_us = bench_now_us() - t0;
+    mt29f_get_stats(&after);
+
+    LOG_INF("async erase: %d us, result %d, %d transactions, %d status polls", (uint32_t)erase_us,
+            rc ? rc : op.result, after.spi_transactions - before.spi_transactions,
+            after.status_polls - before.status_polls);
+}
+
+
+/*
+ * bench_verify_pages: reads back BENCH_PAGES pages at `offset`, each has to match the first page of buf
+ */
+static void bench_verify_pages(const char *what, off_t offset)
+{
+    uint8_t *page = &buf[cfg.bytes_per_page];
+
+    for (size_t i = 0; i < BENCH_PAGES; i++) {
+        const off_t at = offset + (off_t)i * cfg.bytes_per_page;
+
+        bench_check(what, mt29f_read(at, page, cfg.bytes_per_page));
+        bench_verify(what, at, buf, page, cfg.bytes_per_page);
+    }
+}
+
+
+/*
+ * bench_partial: partly filled pages as full page writes vs. partial loads, and a block
+ * relocation through RAM vs. internal data moves
+ */
+static void bench_partial(void)
+{
+    const off_t block_bytes = (off_t)cfg.pages_per_block * cfg.bytes_per_page;
+
+    /* a relocation target on the same die as block 0, the cache register is per die */
+    uint32_t dst = 1;
+    while (mt29f_get_block_die(dst) != mt29f_get_block_die(0)) {
+        dst++;
+    }
+
+    int rc = 0;
+
+    bench_fill(11);
+    memset(&buf[16 + BENCH_RECORD_BYTES], 0xFF, cfg.bytes_per_page - 16 - BENCH_RECORD_BYTES);
+
+    bench_check("erase", mt29f_erase_block(0));
+    uint64_t t0 = bench_now_us();
+    for (size_t page = 0; page < BENCH_PAGES; page++) {
+        rc |= mt29f_write(page * cfg.bytes_per_page, buf, cfg.bytes_per_page);
+    }
+    uint64_t full_us = bench_now_us() - t0;
+    bench_check("full page write", rc);
+    bench_verify_pages("full page write", 0);
+
+    const mt29f_part_t parts[] = {
+        { .col = 0, .len = 16, .data = buf },
+        { .col = 16, .len = BENCH_RECORD_BYTES, .data = &buf[16] },
+    };
+
+    rc = 0;
+    bench_check("erase", mt29f_erase_block(0));
+    t0 = bench_now_us();
+    for (size_t page = 0; page < BENCH_PAGES; page++) {
+        rc |= mt29f_write_parts(page * cfg.bytes_per_page, parts, ARRAY_SIZE(parts), NULL, 0);
+    }
+    uint64_t parts_us = bench_now_us() - t0;
+    bench_check("partial load", rc);
+    bench_verify_pages("partial load", 0);
+
+    LOG_INF("%d byte pages: full page write %d us/page, partial load %d us/page", 16 + BENCH_RECORD_BYTES,
+            (uint32_t)(full_us / BENCH_PAGES), (uint32_t)(parts_us / BENCH_PAGES));
+
+    rc = 0;
+    bench_check("erase", mt29f_erase_block(dst * block_bytes));
+    t0 = bench_now_us();
+    for (size_t page = 0; page < BENCH_PAGES; page++) {
+        rc |= mt29f_read(page * cfg.bytes_per_page, buf, cfg.bytes_per_page);
+        rc |= mt29f_write(dst * block_bytes + page * cfg.bytes_per_page, buf, cfg.bytes_per_page);
+    }
+    uint64_t ram_us = bench_now_us() - t0;
+    bench_check("relocation through RAM", rc);
+    bench_verify_pages("relocation through RAM", dst * block_bytes);
+
+    rc = 0;
+    bench_check("erase", mt29f_erase_block(dst * block_bytes));
+    t0 = bench_now_us();
+    for (size_t page = 0; page < BENCH_PAGES; page++) {
+        rc |= mt29f_page_copy(page * cfg.bytes_per_page, dst * block_bytes + page * cfg.bytes_per_page, NULL, 0);
+    }
+    uint64_t move_us = bench_now_us() - t0;
+    bench_check("internal data move", rc);
+    bench_verify_pages("internal data move", dst * block_bytes);
+
+    LOG_INF("block relocation: through RAM %d ms, internal data move %d ms",
+            (uint32_t)(ram_us / 1000), (uint32_t)(move_us / 1000));
+}
+
+
+/*
+ * bench_interleave: page read latency while a background erase runs on the same die vs.
+ * the other die
+ */
+static void bench_interleave(void)
+{
+    const off_t block_bytes = (off_t)cfg.pages_per_block * cfg.bytes_per_page;
+    uint64_t latency_us[2];
+
+    /* block 0 gets erased in the background, the reads target a block on each die */
+    uint32_t other = 1;
+    while (mt29f_get_block_die(other) == mt29f_get_block_die(0)) {
+        other++;
+    }
+    const off_t targets[2] = { block_bytes, other * block_bytes };
+
+    bench_fill(13);
+    for (size_t i = 0; i < ARRAY_SIZE(targets); i++) {
+        bench_check("erase", mt29f_erase_block(targets[i]));
+        bench_check("write", mt29f_write(targets[i], buf, cfg.bytes_per_page));
+    }
+
+    uint8_t *page = &buf[cfg.bytes_per_page];
+
+    for (size_t i = 0; i < ARRAY_SIZE(targets); i++) {
+        bench_check("write", mt29f_write(0, buf, cfg.bytes_per_page));
+        bench_check("async erase", mt29f_erase_block_async(0));
+
+        /* let the low priority erase worker issue the erase */
+        k_usleep(10);
+
+        uint64_t t0 = bench_now_us();
+        int rc = mt29f_read(targets[i], page, cfg.bytes_per_page);
+        latency_us[i] = bench_now_us() - t0;
+
+        bench_check("read during an erase", rc);
+        bench_verify("read during an erase", targets[i], buf, page, cfg.bytes_per_page);
+    }
+
+    LOG_INF("page read during an erase: same die %d us, other die %d us",
+            (uint32_t)latency_us[0], (uint32_t)latency_us[1]);
+}
+
+
+/*
+ * bench_format: format time with a few blocks written vs. a full chip erase
+ */
+static void bench_format(void)
+{
+    ftl_init(&cfg);
+    ftl_format();
+
+    bench_fill(7);
+    ftl_append_start(0);
+    for (uint32_t block = 0; block < BENCH_FORMAT_BLOCKS; block++) {
+        ftl_append(buf, sizeof(buf));
+    }
+
+    uint64_t t0 = bench_now_us();
+    ftl_format();
+    uint64_t format_us = bench_now_us() - t0;
+
+    t0 = bench_now_us();
+    mt29f_chip_erase();
+    uint64_t chip_us = bench_now_us() - t0;
+
+    LOG_INF("format after %d blocks: %d ms, chip erase of a blank chip: %d ms",
+            BENCH_FORMAT_BLOCKS, (uint32_t)(format_us / 1000), (uint32_t)(chip_us / 1000));
+}
+
+
+/*
+ * bench_endurance: rewrites the whole FTL space and reports the erase count spread
+ */
+static void bench_endurance(void)
+{
+    ftl_format();
+
+    const uint32_t blocks = ftl_get_num_blocks();
+
+    for (int lap = 0; lap < BENCH_ENDURANCE_LAPS; lap++) {
+        bench_fill(lap);
+        ftl_append_start(0);
+        for (uint32_t block = 0; block < blocks; block++) {
+            ftl_append(buf, sizeof(buf));
+        }
+    }
+
+    ftl_wear_stats_t stats;
+    ftl_get_wear_stats(&stats);
+
+    uint32_t min = UINT32_MAX, max = 0;
+    for (uint8_t die = 0; die < cfg.num_dies; die++) {
+        for (uint16_t block = 0; block < cfg.blocks_per_die; block++) {
+            uint32_t ec = mt29f_emul_get_erase_count(emul, die, block);
+            min = MIN(min, ec);
+            max = MAX(max, ec);
+        }
+    }
+
+    LOG_INF("endurance, %d laps: FTL erase counts %d..%d (avg %d), %d static moves",
+            BENCH_ENDURANCE_LAPS, stats.min_erase_count, stats.max_erase_count,
+            stats.avg_erase_count, stats.static_moves);
+    LOG_INF("endurance, %d laps: chip erase counts %d..%d", BENCH_ENDURANCE_LAPS, min, max);
+}
+
+
+/*
+ * bench_power_cut: cuts the supply at several points of a block move and remounts
+ *
+ * A read that reports a refresh queues the block for the scrubber, which moves it onto
+ * a free block. Whether or not the copy reached its commit record before the cut, the
+ * remount has to find every block's data where it was written.
+ */
+static void bench_power_cut(void)
+{
+    static const uint32_t cut_after[] = {1, 16, 63, 64, 65, 80};
+    const size_t main_bytes = cfg.bytes_per_page - cfg.oob_bytes;
+    const off_t block_bytes = (off_t)cfg.pages_per_block * cfg.bytes_per_page;
+    const uint32_t failures = bench_failures;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cut_after); i++) {
+        ftl_wear_stats_t before, after;
+
+        bench_check("ftl init", ftl_init(&cfg));
+        ftl_format();
+        ftl_append_start(0);
+        for (uint32_t block = 0; block < BENCH_CUT_BLOCKS; block++) {
+            bench_fill(100 + block);
+            /* the spare area carries the FTL metadata, leave it erased like nvs does */
+            for (size_t page = 0; page < BENCH_PAGES; page++) {
+                memset(&buf[page * cfg.bytes_per_page + main_bytes], 0xFF, cfg.oob_bytes);
+            }
+            bench_check("ftl append", ftl_append(buf, sizeof(buf)));
+        }
+
+        /* every page 0 reads marginal until the one read of the victim has queued its block */
+        for (uint8_t die = 0; die < cfg.num_dies; die++) {
+            for (uint16_t block = 0; block < cfg.blocks_per_die; block++) {
+                mt29f_emul_set_bitflips(emul, die, block, 0, 6);
+            }
+        }
+        ftl_read(BENCH_CUT_VBLOCK * block_bytes, buf, cfg.bytes_per_page);
+        for (uint8_t die = 0; die < cfg.num_dies; die++) {
+            for (uint16_t block = 0; block < cfg.blocks_per_die; block++) {
+                mt29f_emul_set_bitflips(emul, die, block, 0, 0);
+            }
+        }
+
+        ftl_get_wear_stats(&before);
+        mt29f_emul_set_power_cut(emul, true, cut_after[i]);
+        k_msleep(2 * FTL_SCRUB_PERIOD_MS);
+        ftl_get_wear_stats(&after);
+
+        if (after.refreshed_blocks == before.refreshed_blocks) {
+            LOG_ERR("power cut after %d ops: the scrubber never moved the block", cut_after[i]);
+            bench_failures++;
+        }
+
+        /* supply back: driver and FTL come up from whatever reached the array */
+        mt29f_emul_set_power_cut(emul, false, 0);
+        mt29f_init(&cfg);
+        bench_check("ftl remount", ftl_init(&cfg));
+
+        for (uint32_t block = 0; block < BENCH_CUT_BLOCKS; block++) {
+            const off_t offset = block * block_bytes;
+
+            bench_check("ftl read", ftl_read(offset, buf, sizeof(buf)));
+            for (size_t page = 0; page < BENCH_PAGES; page++) {
+                const size_t at = page * cfg.bytes_per_page;
+                bench_verify_fill("remount", offset + at, 100 + block, at, &buf[at], main_bytes);
+            }
+        }
+    }
+
+    LOG_INF("power cut during a block move, %d cut points: %s", (int)ARRAY_SIZE(cut_after),
+            bench_failures == failures ? "all data intact after remount" : "DATA LOST");
+}
+
+
+/*
+ * bench_mount: FTL mount time from a checkpoint vs. the OOB scan, on a full chip
+ */
+static void bench_mount(void)
+{
+    mt29f_stats_t before, after;
+
+    ftl_checkpoint();
+
+    mt29f_get_stats(&before);
+    uint64_t t0 = bench_now_us();
+    ftl_init(&cfg);
+    uint64_t ckpt_us = bench_now_us() - t0;
+    mt29f_get_stats(&after);
+    const uint32_t ckpt_spi = after.spi_transactions - before.spi_transactions;
+
+    /* without the checkpoint slots the mount falls back to the scan */
+    const uint32_t blocks = mt29f_get_num_blocks();
+    for (uint32_t slot = 1; slot <= FTL_CKPT_SLOTS; slot++) {
+        mt29f_erase_block((off_t)(blocks - slot) * cfg.pages_per_block * cfg.bytes_per_page);
+    }
+
+    mt29f_get_stats(&before);
+    t0 = bench_now_us();
+    ftl_init(&cfg);
+    uint64_t scan_us = bench_now_us() - t0;
+    mt29f_get_stats(&after);
+
+    LOG_INF("mount of a full chip: checkpoint %d us (%d SPI transactions), OOB scan %d us (%d)",
+            (uint32_t)ckpt_us, ckpt_spi, (uint32_t)scan_us,
+            after.spi_transactions - before.spi_transactions);
+}
+
+
+/*
+ * bench_nvs_cache: NVS read cache on a sequential read-back and on re-reads of one page
+ */
+static void bench_nvs_cache(void)
+{
+    static uint8_t payload[NVS_PAGE_PAYLOAD];
+    nvs_cache_stats_t c0, c1;
+    mt29f_stats_t before, after;
+    size_t len;
+
+    int rc = nvs_init();
+    if (rc != 0) {
+        LOG_ERR("nvs init failed: %d", rc);
+        return;
+    }
+    nvs_erase_region();
+
+    memset(payload, 0x5A, sizeof(payload));
+    for (uint32_t i = 0; i < BENCH_LOG_PAGES; i++) {
+        nvs_write(payload, sizeof(payload));
+    }
+
+    nvs_get_cache_stats(&c0);
+    mt29f_get_stats(&before);
+    uint64_t t0 = bench_now_us();
+    for (uint32_t i = 0; i < BENCH_LOG_PAGES; i++) {
+        nvs_read_page((off_t)i * cfg.bytes_per_page, payload, &len, NULL, NULL);
+    }
+    uint64_t seq_us = bench_now_us() - t0;
+    mt29f_get_stats(&after);
+    nvs_get_cache_stats(&c1);
+
+    LOG_INF("nvs cache (%d pages), sequential: %d KB/s, %d SPI transactions, %d hits / %d misses, %d of %d prefetched pages used",
+            NVS_CACHE_PAGES, bench_kbps((size_t)BENCH_LOG_PAGES * cfg.bytes_per_page, seq_us),
+            after.spi_transactions - before.spi_transactions, c1.hits - c0.hits, c1.misses - c0.misses,
+            c1.prefetch_hits - c0.prefetch_hits, c1.prefetched - c0.prefetched);
+
+    nvs_get_cache_stats(&c0);
+    mt29f_get_stats(&before);
+    for (uint32_t i = 0; i < BENCH_LOG_PAGES; i++) {
+        nvs_read_page((off_t)(BENCH_LOG_PAGES - 1) * cfg.bytes_per_page, payload, &len, NULL, NULL);
+    }
+    mt29f_get_stats(&after);
+    nvs_get_cache_stats(&c1);
+
+    LOG_INF("nvs cache, newest page re-read %d times: %d SPI transactions, %d hits / %d misses",
+            BENCH_LOG_PAGES, after.spi_transactions - before.spi_transactions,
+            c1.hits - c0.hits, c1.misses - c0.misses);
+}
+
+
+int main(void)
+{
+    LOG_INF("MT29F benchmarks on the emulator");
+
+    mt29f_init(&cfg);
+
+    bench_read_modes();
+    bench_bus_widths();
+    bench_transactions();
+    bench_async();
+    bench_partial();
+    bench_interleave();
+    bench_format();
+    bench_endurance();
+    bench_mount();
+    bench_power_cut();
+    bench_nvs_cache();
+
+    if (bench_failures > 0) {
+        LOG_ERR("Done, %d checks FAILED", bench_failures);
+        return 1;
+    }
+
+    LOG_INF("Done");
+    return 0;
+}